@@ -0,0 +1,71 @@
+// Measures how many checks per second the rate limiters handle when several threads share one,
+// and how many of them were admitted.  Needs a hosted platform with threads.
+
+#include <Clock.h>
+#include <RateLimit.h>
+#include <pprintf.h>
+
+#if defined(CLOCK_THREADS) && defined(RATELIMIT_ATOMIC)
+
+#include <thread>
+
+const micros_t runMicros = 500000;
+const uint8_t maxThreads = 8;
+
+template <class Limiter> void run(const char* name, Limiter& limiter, uint8_t threadCount) {
+  std::atomic<uint64_t> checks{0};
+  std::atomic<uint64_t> admitted{0};
+  std::thread threads[maxThreads];
+
+  micros_t start = Uptime::micros();
+  for (uint8_t i = 0; i < threadCount; i++) {
+    threads[i] = std::thread([&]() {
+      uint64_t myChecks = 0;
+      uint64_t myAdmitted = 0;
+      micros_t end = start + runMicros;
+      while (Uptime::micros() < end) {
+        for (uint8_t j = 0; j < 64; j++) {
+          myChecks++;
+          myAdmitted += limiter.tryAcquire();
+        }
+      }
+      checks += myChecks;
+      admitted += myAdmitted;
+    });
+  }
+  for (uint8_t i = 0; i < threadCount; i++) {
+    threads[i].join();
+  }
+  micros_t elapsed = Uptime::micros() - start;
+
+  pprintf(&Serial, "%-8s %d threads: %lu checks/sec, %lu admitted/sec\n", name, threadCount,
+          (unsigned long)(checks * Time::microsPerSec / elapsed),
+          (unsigned long)(admitted * Time::microsPerSec / elapsed));
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  for (uint8_t threads = 1; threads <= maxThreads; threads *= 2) {
+    TokenBucket bucket(100000, 1000);
+    run("token", bucket, threads);
+
+    SlidingWindow window(100000, Time::microsPerSec);
+    run("window", window, threads);
+
+    ShardedTokenBucket sharded(100000, 1000);
+    run("sharded", sharded, threads);
+  }
+}
+
+#else
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("RateLimitBenchmark needs a platform with threads");
+}
+
+#endif
+
+void loop() {
+}
@@ -0,0 +1,72 @@
+// Saves a mix of running and paused timers with TimerSnapshot, cancels them,
+// restores them and checks that they come back the way they were.
+
+#include <Clock.h>
+#include <Timer.h>
+#include <Snapshot.h>
+#include <pprintf.h>
+
+const uint8_t timerCount = 4;
+
+Clock rtc;
+CallbackTimer timers[timerCount];
+uint8_t image[128];
+
+bool wasPaused[timerCount];
+millis_t wasRemaining[timerCount];
+
+void fired(void*) {
+}
+
+Timer* lookup(uint32_t id, void*) {
+  return (id >= 1 && id <= timerCount) ? &timers[id - 1] : nullptr;
+}
+
+bool check(uint8_t i, const char* what) {
+  // running timers move on while we save and restore, paused ones must not move at all
+  millis_t slack = wasPaused[i] ? 0 : 10;
+  millis_t remaining = timers[i].remainingMillis();
+  bool ok = timers[i].isPaused() == wasPaused[i] &&
+            remaining <= wasRemaining[i] && remaining >= wasRemaining[i] - slack &&
+            !timers[i].hasPassed();
+  pprintf(&Serial, "%s: %s (remaining %d ms, was %d ms)\n", what, ok ? "ok" : "FAILED", (int)remaining, (int)wasRemaining[i]);
+  return ok;
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+
+  rtc.setDateTime(2023, 11, 14, 22, 13, 20);
+
+  timers[0].setMillis(5000, fired, nullptr, true);
+  timers[1].setMillis(7000, fired, nullptr);
+  timers[1].pause();
+  timers[2].setClockTime(rtc.now() + 60, fired, nullptr);
+  timers[3].setClockTime(rtc.now() + 100, fired, nullptr);
+  timers[3].pause();
+
+  for (uint8_t i = 0; i < timerCount; i++) {
+    timers[i].setId(i + 1);
+    wasPaused[i] = timers[i].isPaused();
+    wasRemaining[i] = timers[i].remainingMillis();
+  }
+
+  size_t len = TimerSnapshot::save(image, sizeof(image));
+  pprintf(&Serial, "snapshot: %d bytes\n", (int)len);
+
+  for (uint8_t i = 0; i < timerCount; i++) {
+    timers[i].cancel();
+  }
+
+  bool ok = TimerSnapshot::restore(image, len, lookup);
+  ok = check(0, "running millis timer") && ok;
+  ok = check(1, "paused millis timer") && ok;
+  ok = check(2, "running clock time timer") && ok;
+  ok = check(3, "paused clock time timer") && ok;
+  Serial.println(ok ? "all ok" : "FAILED");
+}
+
+void loop() {
+  Timer::idle();
+}
@@ -0,0 +1,55 @@
+// Awaits a coroutine whose frame is too big for the TimerTask frame pool.
+// Normally the frame goes to the heap and the task runs.  Built with TIMERTASK_POOL_ONLY defined
+// (for the library too, for example in build_flags) the task can't be allocated, and co_await gives 0 instead.
+
+#include <Clock.h>
+#include <TimerTask.h>
+#include <pprintf.h>
+
+#if defined(TIMERTASK_COROUTINES)
+
+TimerTask<int> small() {
+  co_await sleepFor(10);
+  co_return 42;
+}
+
+TimerTask<int> big() {
+  // kept across the sleep, so it has to live in the coroutine frame
+  volatile uint8_t scratch[TIMERTASK_FRAME_SIZE];
+  scratch[0] = 42;
+  co_await sleepFor(10);
+  co_return scratch[0];
+}
+
+TimerTask<> check() {
+  int s = co_await small();
+  int b = co_await big();
+#if defined(TIMERTASK_POOL_ONLY)
+  bool ok = s == 42 && b == 0 && TimerTaskPool::failedFrames() == 1;
+#else
+  bool ok = s == 42 && b == 42 && TimerTaskPool::heapFrames() == 1;
+#endif
+  pprintf(&Serial, "small %d, big %d, heap frames %lu, failed frames %lu: %s\n", s, b,
+          (unsigned long)TimerTaskPool::heapFrames(), (unsigned long)TimerTaskPool::failedFrames(), ok ? "ok" : "FAILED");
+}
+
+void setup() {
+  Serial.begin(115200);
+  spawn(check());
+}
+
+void loop() {
+  Timer::idle();
+}
+
+#else
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("TimerTaskPool needs a compiler with C++20 coroutines");
+}
+
+void loop() {
+}
+
+#endif
@@ -3,6 +3,7 @@
 #include "Clock.h"
 #include "TimeLib.h"
 #include "pprintf.h"
+#include "EventTrace.h"
 
 static  const uint8_t monthDays[]={31,28,31,30,31,30,31,31,30,31,30,31}; // API starts months from 1, this array starts from 0
 
@@ -78,6 +79,14 @@ const char* Time::monthString(uint8_t m) {
   return monthStrings[m];
 }
 
+const char* Time::weekdayName(uint8_t d) {
+  return dayStrings[d];
+}
+
+const char* Time::monthName(uint8_t m) {
+  return monthStrings[m];
+}
+
 uint8_t Time::daysInMonth(uint8_t m) {
   if (m == 0) {
     m = month();
@@ -129,17 +138,36 @@ void Time::longTime(Print& p) {
 //////////////////////////////////////////////////////////////////////////////
 // Uptime Methods
 //
-micros_t Uptime::lastUptimeMicros = 0;
-micros_t Uptime::uptimeOffsetMicros = 0;
+#if defined(CLOCK_THREADS)
+std::atomic<uint64_t> Uptime::uptimeBaseMicros{0};
+#else
+uint64_t Uptime::uptimeBaseMicros = 0;
+#endif
+uptimeSource_t Uptime::_source = nullptr;
 
 micros_t Uptime::micros() {
-  micros_t nowUptime = ::micros();
-  if (nowUptime < lastUptimeMicros) {
-    // micros have rolled over, we add a new offset
-    uptimeOffsetMicros += 0x0000000100000000;
+  if (_source) {
+    return _source();
+  }
+
+  uint32_t now = ::micros();
+  // the counter has moved by the signed 32 bit difference from the base, even across a rollover.
+  // the base is only moved on every 2^24 us or so, so that calls from many threads only read it
+#if defined(CLOCK_THREADS)
+  uint64_t base = uptimeBaseMicros.load(std::memory_order_relaxed);
+#else
+  uint64_t base = uptimeBaseMicros;
+#endif
+  uint64_t extended = base ? base + (int32_t)(now - (uint32_t)base) : now;
+  if (extended >= base + uptimeBaseStep || !base) {
+#if defined(CLOCK_THREADS)
+    // another thread may have moved it already, only ever move it forward
+    while (extended > base && !uptimeBaseMicros.compare_exchange_weak(base, extended, std::memory_order_relaxed)) {}
+#else
+    uptimeBaseMicros = extended;
+#endif
   }
-  lastUptimeMicros = nowUptime;
-  return nowUptime + uptimeOffsetMicros;
+  return extended;
 }
 
 void Uptime::longTime(Print& p) {
@@ -184,7 +212,7 @@ bool RTCClock::_is_setting = false;
 void RTCClock::setMicros(micros_t newTime) {
   _micros_offset = Uptime::micros();
   micros_t zone_offset = 0;
-  zone_offset = microsPerSec * getZone()->offset(getZone()->toUTC(newTime/microsPerSec));
+  zone_offset = microsPerSec * zoneOffset(zoneToUTC(newTime/microsPerSec));
   _utc_micros_time = newTime - zone_offset;
 }
 
@@ -193,13 +221,14 @@ micros_t RTCClock::getMicros() {
   micros_t up = Uptime::micros();
   if (_update_interval && (up - _last_update) > _update_interval) {
     _last_update = up;
+    CLOCK_TRACE_EVENT(traceClockUpdate, 0);
     updateTime();
   }
 
   micros_t zone_offset = 0;
   micros_t utc_now = _utc_micros_time + up - _micros_offset;
 
-  zone_offset = microsPerSec * getZone()->offset(utc_now/microsPerSec);
+  zone_offset = microsPerSec * zoneOffset(utc_now/microsPerSec);
 
   return utc_now + zone_offset;
 }
@@ -221,12 +250,14 @@ TeensyClock::TeensyClock() {
 void TeensyClock::updateTime() {
   _last_update = Uptime::micros();
   Timezone* savedZone = getZone();
+  LocalZone* savedLocalZone = getLocalZone();
   setZone(nullptr);
 
   // set the object time to the hardware RTC time
   RTCClock::setMicros(getRTCMicros());
 
   setZone(savedZone);
+  if (savedLocalZone) { setZone(savedLocalZone); }
 
 }
 
@@ -236,12 +267,14 @@ void TeensyClock::setMicros(micros_t newTime) {
   RTCClock::setMicros(newTime);
 
   Timezone* savedZone = getZone();
+  LocalZone* savedLocalZone = getLocalZone();
   setZone(nullptr);
 
   // set the hardware RTC to the new time (without a zone)
   setRTCMicros(getMicros());
 
   setZone(savedZone);
+  if (savedLocalZone) { setZone(savedLocalZone); }
 
 }
 #if defined(ARDUINO_TEENSY31) || defined(ARDUINO_TEENSY36)
@@ -21,6 +21,12 @@ typedef int64_t millis_t;
 // microseconds are always expressed as 64-bit numbers, to avoid rollover
 typedef int64_t micros_t;
 
+// hosted platforms may use the library from more than one thread
+#if defined(__unix__) || defined(__APPLE__) || defined(_WIN32)
+#define CLOCK_THREADS
+#include <atomic>
+#endif
+
 // Time is a base class that represents a point in time and provides utility functions for getting information about that time
 // Time does not change unless you set() it.
 // Use Clock (or one of its descendents) for a real-time clock.
@@ -80,6 +86,8 @@ class Time {
     const char* weekdayString(uint8_t d = 0 );  // zero means current day
     const char* monthString(uint8_t m = 0); // zero means current month
     uint8_t daysInMonth(uint8_t m = 0);  // zero means current month, months are 1 based
+    static const char* weekdayName(uint8_t d);  // 1 is Sunday
+    static const char* monthName(uint8_t m);    // 1 is January
 
     static const time_t secsPerMin = 60L;
     static const time_t secsPerMinute = secsPerMin;
@@ -123,8 +131,13 @@ class YearTime : public DayTime {
 };
 
 
+// Uptime source function, returns 64-bit microseconds since start, must never go backwards
+typedef micros_t (*uptimeSource_t)();
+
 // Uptime provides a Time that is tied to the micros() since the system started.  Easiest access is by Uptime::micros() or Uptime::millis()
 // Setting has no effect.
+// The 32 bit hardware counter is extended to 64 bits, which needs micros() to be called at least every 2^31 - 2^24 us (about 35 minutes).
+// The hardware counter can be replaced with setSource(), for example to run on simulated time.
 class Uptime : public Time {
   public:
     static micros_t micros();
@@ -135,9 +148,26 @@ class Uptime : public Time {
 
     micros_t getMicros() { return micros(); }
 
+    static void setSource(uptimeSource_t source) { _source = source; }  // nullptr restores the hardware counter
+    static uptimeSource_t getSource() { return _source; }
+
   private:
-    static micros_t lastUptimeMicros;
-    static micros_t uptimeOffsetMicros;
+    // a recent value of the hardware counter extended to 64 bits, that the counter is extended from
+#if defined(CLOCK_THREADS)
+    static std::atomic<uint64_t> uptimeBaseMicros;
+#else
+    static uint64_t uptimeBaseMicros;
+#endif
+    static const uint32_t uptimeBaseStep = 0x1000000;  // how far the counter moves before the base is moved
+    static uptimeSource_t _source;
+};
+
+// LocalZone is a time zone that isn't a Timezone rule object, for example a TZifZone loaded from the zoneinfo database
+class LocalZone {
+  public:
+    virtual ~LocalZone() {}
+    virtual stime_t offset(time_t utc) = 0;  // seconds to add to utc to get local time
+    virtual time_t toUTC(time_t local) { return local - offset(local - offset(local)); }
 };
 
 class LocalTime : public Time {
@@ -147,36 +177,42 @@ class LocalTime : public Time {
     virtual micros_t getMicros() { return Time::getMicros() + getZoneOffset(); };
     virtual void setMicros(micros_t newTime) {
       micros_t off = 0;
-      if (_zone) {
+      if (_zone || _localZone) {
         time_t newSecs = newTime / microsPerSec;
-        off = microsPerSec * _zone->offset(_zone->toUTC(newSecs));
+        off = microsPerSec * zoneOffset(zoneToUTC(newSecs));
       }
       Time::setMicros(newTime - off);
     };
 
-    void setZone(Timezone* zone) { _zone = zone; }
+    void setZone(Timezone* zone) { _zone = zone; _localZone = nullptr; }
+    void setZone(LocalZone* zone) { _localZone = zone; _zone = nullptr; }
+    void setZone(decltype(nullptr)) { setZone((Timezone*)nullptr); }
     inline Timezone* getZone(void) {
       if (_zone)
         return _zone;
       else
         return _systemtimezone;
     }
+    inline LocalZone* getLocalZone(void) { return _localZone; }
+
+    // offset and conversion of the zone in effect, whichever kind it is
+    stime_t zoneOffset(time_t utc) { return _localZone ? _localZone->offset(utc) : getZone()->offset(utc); }
+    time_t zoneToUTC(time_t local) { return _localZone ? _localZone->toUTC(local) : getZone()->toUTC(local); }
 
     stime_t getZoneOffset() {
-      if (_zone) {
-        return _zone->offset(getSeconds());
-      } else {
-        return _systemtimezone->offset(getSeconds());
-      }
+      return zoneOffset(getSeconds());
     }
-    TimeChangeRule* getZoneRule() {
-      if (_zone) {
+    TimeChangeRule* getZoneRule() {  // nullptr for a LocalZone
+      if (_localZone) {
+        return nullptr;
+      } else if (_zone) {
         return _zone->rule(getSeconds());
       } else {
         return _systemtimezone->rule(getSeconds());
       }
     }
 
+    static Timezone* getSystemTimezone() { return _systemtimezone; }
     static void setSystemTimezone(Timezone* systemTimezone) {
       if (systemTimezone) {
        _systemtimezone = systemTimezone;
@@ -186,6 +222,7 @@ class LocalTime : public Time {
     }
   private:
     Timezone* _zone = nullptr;
+    LocalZone* _localZone = nullptr;
     static Timezone* _systemtimezone;
 };
 
@@ -216,7 +253,14 @@ class RTCClock : public LocalTime {
     void setUpdateInterval(time_t i) { _update_interval = i * microsPerSec; }
     time_t getUpdateInterval() { return _update_interval / microsPerSec; }
 
+    // shared UTC time, without the zone offset and without triggering an update
+    static micros_t utcMicros() { return _utc_micros_time + Uptime::micros() - _micros_offset; }
+
+    // uptime micros after which the next getMicros() will call updateTime(), 0 if there is no update interval
+    static micros_t nextUpdate() { return _update_interval ? _last_update + _update_interval + 1 : 0; }
+
   protected:
+    friend class TimerSnapshot;
     static micros_t _micros_offset;
     static bool _is_setting;
     static micros_t _update_interval;
@@ -0,0 +1,168 @@
+#include "EventTrace.h"
+#include "pprintf.h"
+
+TraceBuffer EventTrace::_buffers[EVENTTRACE_THREADS];
+bool EventTrace::_enabled = true;
+#if defined(CLOCK_THREADS)
+std::atomic<bool> EventTrace::_claimed[EVENTTRACE_THREADS];
+std::atomic<uint16_t> EventTrace::_threads{0};
+std::atomic<uint32_t> EventTrace::_dropped{0};
+#else
+uint32_t EventTrace::_dropped = 0;
+#endif
+
+void TraceBuffer::record(uint16_t event, uint32_t arg, micros_t time) {
+#if defined(CLOCK_THREADS)
+  uint32_t h = _head.load(std::memory_order_relaxed);
+#else
+  uint32_t h = _head;
+#endif
+  TraceSlot& slot = at(h);
+#if defined(CLOCK_THREADS)
+  slot.seq.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+#else
+  slot.seq = 0;
+#endif
+  TraceRecord& r = slot.record;
+  r.time = time;
+  r.event = event;
+  r.thread = this - EventTrace::_buffers;
+  r.arg = arg;
+#if defined(CLOCK_THREADS)
+  slot.seq.store(h + 1, std::memory_order_release);
+  _head.store(h + 1, std::memory_order_release);
+#else
+  slot.seq = h + 1;
+  _head = h + 1;
+#endif
+}
+
+bool TraceBuffer::get(uint32_t i, TraceRecord& r) {
+  TraceSlot& slot = at(i);
+#if defined(CLOCK_THREADS)
+  if (slot.seq.load(std::memory_order_acquire) != i + 1) {
+    return false;
+  }
+  r = slot.record;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return slot.seq.load(std::memory_order_relaxed) == i + 1;
+#else
+  if (slot.seq != i + 1) {
+    return false;
+  }
+  r = slot.record;
+  return slot.seq == i + 1;
+#endif
+}
+
+#if defined(CLOCK_THREADS)
+static thread_local TraceBuffer* threadBuffer = nullptr;
+static thread_local bool threadExiting = false;
+
+// gives the thread's buffer back when the thread exits, its events stay readable until they're overwritten
+struct TraceBufferHolder {
+  ~TraceBufferHolder() {
+    threadExiting = true;
+    if (threadBuffer) {
+      EventTrace::_claimed[threadBuffer - EventTrace::_buffers].store(false, std::memory_order_release);
+      threadBuffer = nullptr;
+    }
+  }
+};
+
+TraceBuffer* EventTrace::claim() {
+  for (uint16_t i = 0; i < EVENTTRACE_THREADS; i++) {
+    bool claimed = false;
+    if (_claimed[i].compare_exchange_strong(claimed, true, std::memory_order_acquire)) {
+      uint16_t threads = _threads.load();
+      while (threads < i + 1 && !_threads.compare_exchange_weak(threads, i + 1)) {}
+      return &_buffers[i];
+    }
+  }
+  return nullptr;
+}
+#endif
+
+TraceBuffer* EventTrace::buffer() {
+#if defined(CLOCK_THREADS)
+  if (!threadBuffer) {
+    if (threadExiting) {
+      return nullptr;
+    }
+    threadBuffer = claim();
+    if (!threadBuffer) {
+      _dropped++;
+      return nullptr;
+    }
+    static thread_local TraceBufferHolder holder;
+    (void)holder;
+  }
+  return threadBuffer;
+#else
+  return &_buffers[0];
+#endif
+}
+
+void EventTrace::read(traceReader_t reader, void* readerData) {
+  uint16_t count = EVENTTRACE_THREADS;
+#if defined(CLOCK_THREADS)
+  count = _threads.load();
+  if (count > EVENTTRACE_THREADS) { count = EVENTTRACE_THREADS; }
+  std::atomic_thread_fence(std::memory_order_acquire);
+#endif
+
+  // read position and end of each buffer, records past the end are left for the next read
+  uint32_t next[EVENTTRACE_THREADS];
+  uint32_t end[EVENTTRACE_THREADS];
+  for (uint16_t i = 0; i < count; i++) {
+    end[i] = _buffers[i].head();
+    next[i] = end[i] > EVENTTRACE_BUFFER_SIZE ? end[i] - EVENTTRACE_BUFFER_SIZE : 0;
+  }
+
+  // each buffer is already in time order, so merge by repeatedly taking the oldest head
+  while (true) {
+    int16_t oldest = -1;
+    TraceRecord r = {};
+    for (uint16_t i = 0; i < count; i++) {
+      while (next[i] < end[i]) {
+        TraceRecord candidate;
+        if (!_buffers[i].get(next[i], candidate)) {
+          // the writer has lapped us, skip to the oldest event that can still be there
+          uint32_t oldestLeft = _buffers[i].head() - EVENTTRACE_BUFFER_SIZE + 1;
+          next[i] = (int32_t)(oldestLeft - next[i]) > 0 ? oldestLeft : next[i] + 1;
+          continue;
+        }
+        if (oldest < 0 || candidate.time < r.time) {
+          oldest = i;
+          r = candidate;
+        }
+        break;
+      }
+    }
+    if (oldest < 0) {
+      return;
+    }
+    next[oldest]++;
+    if (!reader(r, readerData)) {
+      return;
+    }
+  }
+}
+
+static bool printRecord(const TraceRecord& r, void* p) {
+  const char* name = "event";
+  if (r.event == traceTimerFire) {
+    name = "timer";
+  } else if (r.event == traceClockUpdate) {
+    name = "clock update";
+  }
+  pprintf((Print*)p, "%lu.%06lu [%d] %s %d %lu\n",
+          (unsigned long)(r.time / Time::microsPerSec), (unsigned long)(r.time % Time::microsPerSec),
+          (int)r.thread, name, (int)r.event, (unsigned long)r.arg);
+  return true;
+}
+
+void EventTrace::print(Print& p) {
+  read(&printRecord, &p);
+}
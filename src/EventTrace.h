@@ -0,0 +1,112 @@
+#ifndef _EventTrace_
+#define _EventTrace_
+
+#include "Clock.h"
+
+#if defined(CLOCK_THREADS)
+#include <atomic>
+#endif
+
+// EventTrace records small fixed size events, timestamped with Uptime::micros(), into per-thread ring buffers.
+// Recording takes no locks, each thread only writes its own buffer, and when a buffer is full the oldest events are overwritten.
+// Readers merge all the buffers in timestamp order.
+//
+// Timer::idle() and RTCClock updates have built in trace points, compiled in when CLOCK_TRACE is defined.
+
+#if !defined(EVENTTRACE_BUFFER_SIZE)
+#if defined(CLOCK_THREADS)
+#define EVENTTRACE_BUFFER_SIZE 4096  // events per thread, must be a power of 2
+#else
+#define EVENTTRACE_BUFFER_SIZE 64
+#endif
+#endif
+
+#if !defined(EVENTTRACE_THREADS)
+#if defined(CLOCK_THREADS)
+#define EVENTTRACE_THREADS 16  // threads recording at once, events from more threads are dropped.  An exiting thread's buffer is reused
+#else
+#define EVENTTRACE_THREADS 1
+#endif
+#endif
+
+static_assert((EVENTTRACE_BUFFER_SIZE & (EVENTTRACE_BUFFER_SIZE - 1)) == 0, "EVENTTRACE_BUFFER_SIZE must be a power of 2");
+
+enum traceEvent_t {
+  traceTimerFire = 1,    // arg is the timer id, or the low bits of its address if it has none
+  traceClockUpdate = 2,  // RTCClock::updateTime() called
+  traceUser = 0x100      // application events start here
+};
+
+struct TraceRecord {
+  micros_t time;
+  uint16_t event;
+  uint16_t thread;  // the buffer it was recorded in, a buffer is reused once its thread has exited
+  uint32_t arg;
+};
+
+// return false to stop reading
+typedef bool (*traceReader_t)(const TraceRecord& record, void* readerData);
+
+// each slot carries the sequence number of the event in it, so a reader can tell when the writer has lapped it mid copy
+struct TraceSlot {
+#if defined(CLOCK_THREADS)
+  std::atomic<uint32_t> seq{0};  // event index + 1 once written, 0 while being written
+#else
+  volatile uint32_t seq = 0;
+#endif
+  TraceRecord record;
+};
+
+class TraceBuffer {
+  public:
+    void record(uint16_t event, uint32_t arg, micros_t time);
+    bool get(uint32_t i, TraceRecord& r);  // false if event i has been overwritten or is being overwritten
+
+    uint32_t head() { return _head; }  // count of events ever recorded
+
+  private:
+    TraceSlot& at(uint32_t i) { return _slots[i & (EVENTTRACE_BUFFER_SIZE - 1)]; }
+
+    TraceSlot _slots[EVENTTRACE_BUFFER_SIZE];
+#if defined(CLOCK_THREADS)
+    std::atomic<uint32_t> _head{0};
+#else
+    volatile uint32_t _head = 0;
+#endif
+};
+
+class EventTrace {
+  public:
+    static void record(uint16_t event, uint32_t arg = 0) { if (_enabled) { TraceBuffer* b = buffer(); if (b) { b->record(event, arg, Uptime::micros()); } } }
+
+    static void enable(bool on = true) { _enabled = on; }
+    static bool isEnabled() { return _enabled; }
+
+    static void read(traceReader_t reader, void* readerData = nullptr);  // all buffered events, oldest first
+    static void print(Print& p);
+    static uint32_t dropped() { return _dropped; }  // events from threads that found no free buffer
+
+  private:
+    friend class TraceBuffer;
+    friend struct TraceBufferHolder;
+    static TraceBuffer* buffer();
+
+    static TraceBuffer _buffers[EVENTTRACE_THREADS];
+    static bool _enabled;
+#if defined(CLOCK_THREADS)
+    static TraceBuffer* claim();
+    static std::atomic<bool> _claimed[EVENTTRACE_THREADS];
+    static std::atomic<uint16_t> _threads;  // buffers ever claimed, they're claimed lowest first
+    static std::atomic<uint32_t> _dropped;
+#else
+    static uint32_t _dropped;
+#endif
+};
+
+#if defined(CLOCK_TRACE)
+#define CLOCK_TRACE_EVENT(event, arg) EventTrace::record(event, arg)
+#else
+#define CLOCK_TRACE_EVENT(event, arg)
+#endif
+
+#endif
@@ -0,0 +1,47 @@
+#include "Histogram.h"
+#include "pprintf.h"
+
+void Histogram::clear() {
+  for (uint16_t b = 0; b < bucketCount; b++) {
+    _buckets[b] = 0;
+  }
+  _count = 0;
+  _total = 0;
+  _min = 0;
+  _max = 0;
+}
+
+uint32_t Histogram::bucketMax(uint16_t b) {
+  if (b < (1u << HISTOGRAM_SUB_BITS)) {
+    return b;
+  }
+  uint8_t shift = (b >> HISTOGRAM_SUB_BITS) - 1;
+  uint64_t low = (uint64_t)((1u << HISTOGRAM_SUB_BITS) + (b & ((1u << HISTOGRAM_SUB_BITS) - 1))) << shift;
+  return low + ((uint64_t)1 << shift) - 1;
+}
+
+uint32_t Histogram::percentile(uint16_t perMille) {
+  if (_count == 0) {
+    return 0;
+  }
+  uint64_t want = ((uint64_t)_count * perMille + 999) / 1000;
+  if (want == 0) {
+    want = 1;
+  }
+  uint64_t seen = 0;
+  for (uint16_t b = 0; b < bucketCount; b++) {
+    seen += _buckets[b];
+    if (seen >= want) {
+      uint32_t v = bucketMax(b);
+      return v > _max ? _max : v;
+    }
+  }
+  return _max;
+}
+
+void Histogram::printInfo(Print* p, const char* units) {
+  pprintf(p, "count: %lu, min: %lu %s, mean: %lu %s\n", (unsigned long)_count, (unsigned long)_min, units, (unsigned long)mean(), units);
+  pprintf(p, "p50: %lu %s, p99: %lu %s, p99.9: %lu %s, max: %lu %s\n",
+          (unsigned long)percentile(500), units, (unsigned long)percentile(990), units,
+          (unsigned long)percentile(999), units, (unsigned long)_max, units);
+}
@@ -0,0 +1,57 @@
+#ifndef _Histogram_
+#define _Histogram_
+
+#include "Clock.h"
+
+// Histogram counts 32 bit values (typically microseconds) in log-linear buckets: values below 2^HISTOGRAM_SUB_BITS
+// have their own buckets, larger ones are split into 2^HISTOGRAM_SUB_BITS buckets per power of two,
+// so percentiles are within 1/2^HISTOGRAM_SUB_BITS of the true value.  Adding a value never allocates.
+
+#if !defined(HISTOGRAM_SUB_BITS)
+#if defined(CLOCK_THREADS)
+#define HISTOGRAM_SUB_BITS 3
+#else
+#define HISTOGRAM_SUB_BITS 2
+#endif
+#endif
+
+class Histogram {
+  public:
+    void add(uint32_t value) {
+      _buckets[bucket(value)]++;
+      if (_count == 0 || value < _min) { _min = value; }
+      if (value > _max) { _max = value; }
+      _count++;
+      _total += value;
+    }
+    void clear();
+
+    uint32_t count() { return _count; }
+    uint64_t total() { return _total; }
+    uint32_t min() { return _min; }
+    uint32_t max() { return _max; }
+    uint32_t mean() { return _count ? _total / _count : 0; }
+    uint32_t percentile(uint16_t perMille);  // e.g. 500 for the median, 999 for p99.9
+
+    void printInfo(Print* p, const char* units = "us");  // count, min, mean, p50, p99, p99.9 and max
+
+    static const uint16_t bucketCount = (32 - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS;
+
+  private:
+    static uint16_t bucket(uint32_t value) {
+      if (value < (1u << HISTOGRAM_SUB_BITS)) {
+        return value;
+      }
+      uint8_t msb = sizeof(unsigned long) * 8 - 1 - __builtin_clzl(value);  // clz takes an int, which is only 16 bits on AVR
+      return ((msb - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS) + ((value >> (msb - HISTOGRAM_SUB_BITS)) & ((1u << HISTOGRAM_SUB_BITS) - 1));
+    }
+    static uint32_t bucketMax(uint16_t b);  // largest value in the bucket
+
+    uint32_t _buckets[bucketCount] = {};
+    uint32_t _count = 0;
+    uint64_t _total = 0;
+    uint32_t _min = 0;
+    uint32_t _max = 0;
+};
+
+#endif
@@ -0,0 +1,181 @@
+#include "Profiler.h"
+#include "pprintf.h"
+
+#if defined(CLOCK_THREADS)
+#include <atomic>
+#endif
+
+ProfileTree* Profiler::_trees[PROFILER_THREADS];
+uint64_t Profiler::_nanosPerCycle = (uint64_t)1000 << 32;
+uint64_t Profiler::_maxCycles = 0xffffffffffffffff / ((uint64_t)1000 << 32);
+
+uint64_t Profiler::cyclesToNanos(uint64_t cycles) {
+  if (cycles > _maxCycles) {
+    return 0xffffffffffffffff;
+  }
+  return (cycles * _nanosPerCycle) >> 32;
+}
+
+bool Profiler::calibrate() {
+#if defined(PROFILER_CYCLE_COUNTER)
+  // count cycles across a couple of milliseconds of Uptime, once, before the first scope is timed
+  micros_t start = Uptime::micros();
+  while (Uptime::micros() == start) {}
+  start = Uptime::micros();
+  uint64_t startCycles = cycles();
+  micros_t end;
+  while ((end = Uptime::micros()) - start < 2000) {}
+  uint64_t counted = cycles() - startCycles;
+  if (counted) {
+    _nanosPerCycle = ((uint64_t)(end - start) * 1000 << 32) / counted;
+    _maxCycles = _nanosPerCycle ? 0xffffffffffffffff / _nanosPerCycle : 0xffffffffffffffff;
+  }
+#endif
+  return true;
+}
+
+ProfileTree::ProfileTree() {
+  clear();
+}
+
+void ProfileTree::clear() {
+  _nodes[0].name = "total";
+  _nodes[0].parent = noNode;
+  _nodes[0].firstChild = noNode;
+  _nodes[0].nextSibling = noNode;
+  _nodes[0].histogram.clear();
+  _used = 1;
+  _current = 0;
+}
+
+uint16_t ProfileTree::enter(const char* name) {
+  ProfileNode& parent = _nodes[_current];
+  uint16_t n = parent.firstChild;
+  while (n != noNode && _nodes[n].name != name) {
+    n = _nodes[n].nextSibling;
+  }
+  if (n == noNode) {
+    if (_used >= PROFILER_NODES) {
+      return noNode;
+    }
+    n = _used++;
+    ProfileNode& node = _nodes[n];
+    node.name = name;
+    node.parent = _current;
+    node.firstChild = noNode;
+    node.nextSibling = parent.firstChild;
+    node.histogram.clear();
+    parent.firstChild = n;
+  }
+  _current = n;
+  return n;
+}
+
+void ProfileTree::exit(uint16_t n, uint64_t cycles) {
+  ProfileNode& node = _nodes[n];
+  uint64_t elapsed = Profiler::cyclesToNanos(cycles);
+  node.histogram.add(elapsed > 0xffffffff ? 0xffffffff : (uint32_t)elapsed);
+  _current = node.parent;
+}
+
+static const uint32_t nanosPerMicro = 1000;
+static const uint32_t nanosPerMilli = 1000000;
+
+static void printMicros(Print* p, const char* label, uint32_t nanos) {
+  pprintf(p, "%s%lu.%03lu us", label, (unsigned long)(nanos / nanosPerMicro), (unsigned long)(nanos % nanosPerMicro));
+}
+
+void ProfileTree::printInfo(Print* p, uint16_t n, uint8_t depth) {
+  ProfileNode& node = _nodes[n];
+  if (n != 0) {
+    for (uint8_t i = 1; i < depth; i++) {
+      p->print("  ");
+    }
+    Histogram& h = node.histogram;
+    pprintf(p, "%s: %lu calls, %lu ms total, ", node.name, (unsigned long)h.count(), (unsigned long)(h.total() / nanosPerMilli));
+    printMicros(p, "min ", h.min());
+    printMicros(p, ", p50 ", h.percentile(500));
+    printMicros(p, ", p99 ", h.percentile(990));
+    printMicros(p, ", max ", h.max());
+    p->println();
+  }
+  // children were added at the front, so print them in reverse to show them in the order they first ran
+  uint16_t children[PROFILER_NODES];
+  uint16_t count = 0;
+  for (uint16_t c = node.firstChild; c != ProfileTree::noNode; c = _nodes[c].nextSibling) {
+    children[count++] = c;
+  }
+  while (count) {
+    printInfo(p, children[--count], depth + 1);
+  }
+}
+
+#if defined(CLOCK_THREADS)
+static std::atomic<bool> treeClaimed[PROFILER_THREADS];
+static thread_local ProfileTree* threadTree = nullptr;
+static thread_local uint16_t threadTreeIndex = 0;
+static thread_local bool threadExiting = false;
+
+// gives the thread's tree back when the thread exits, the next new thread adds to it instead of allocating another
+struct ProfileTreeHolder {
+  ~ProfileTreeHolder() {
+    threadExiting = true;
+    if (threadTree) {
+      treeClaimed[threadTreeIndex].store(false, std::memory_order_release);
+      threadTree = nullptr;
+    }
+  }
+};
+#endif
+
+ProfileTree* Profiler::tree() {
+#if defined(CLOCK_THREADS)
+  if (!threadTree) {
+    if (threadExiting) {
+      return nullptr;
+    }
+    static bool calibrated = calibrate();
+    (void)calibrated;
+    for (uint16_t t = 0; t < PROFILER_THREADS; t++) {
+      bool claimed = false;
+      if (treeClaimed[t].compare_exchange_strong(claimed, true, std::memory_order_acquire)) {
+        if (!_trees[t]) {
+          _trees[t] = new ProfileTree();  // only the first time this slot is used
+        }
+        threadTree = _trees[t];
+        threadTreeIndex = t;
+        static thread_local ProfileTreeHolder holder;
+        (void)holder;
+        break;
+      }
+    }
+  }
+  return threadTree;
+#else
+  static ProfileTree only;
+  if (!_trees[0]) {
+    calibrate();
+    _trees[0] = &only;
+  }
+  return &only;
+#endif
+}
+
+void Profiler::printInfo(Print* p) {
+  for (uint16_t t = 0; t < PROFILER_THREADS; t++) {
+    if (_trees[t]) {
+      if (PROFILER_THREADS > 1) {
+        pprintf(p, "Thread %d:\n", t);
+      }
+      _trees[t]->printInfo(p);
+    }
+  }
+}
+
+void Profiler::clear() {
+  for (uint16_t t = 0; t < PROFILER_THREADS; t++) {
+    if (_trees[t]) {
+      _trees[t]->clear();
+    }
+  }
+}
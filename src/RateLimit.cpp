@@ -0,0 +1,230 @@
+#include "RateLimit.h"
+
+#if defined(RATELIMIT_ATOMIC)
+#define ATOMIC_LOAD(a) (a).load()
+#define ATOMIC_STORE(a, v) (a).store(v)
+#define ATOMIC_CAS(a, expected, desired) (a).compare_exchange_weak(expected, desired)
+#else
+#define ATOMIC_LOAD(a) (a)
+#define ATOMIC_STORE(a, v) ((a) = (v))
+static inline bool ATOMIC_CAS(int64_t& a, int64_t&, int64_t desired) { a = desired; return true; }
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// TokenBucket Methods
+//
+void TokenBucket::setRate(uint32_t ratePerSec, uint32_t burst) {
+  if (ratePerSec == 0) { ratePerSec = 1; }
+  if (burst == 0) { burst = 1; }
+  _interval = 1000 * Time::microsPerSec / ratePerSec;
+  _tolerance = _interval * burst;
+}
+
+void TokenBucket::reset() {
+  ATOMIC_STORE(_full, 0);
+}
+
+bool TokenBucket::tryAcquire(uint32_t tokens) {
+  int64_t now = nowNanos();
+  int64_t full = ATOMIC_LOAD(_full);
+  while (true) {
+    int64_t next = (full > now ? full : now) + _interval * tokens;
+    if (next - now > _tolerance) {
+      return false;
+    }
+    if (ATOMIC_CAS(_full, full, next)) {
+      return true;
+    }
+  }
+}
+
+micros_t TokenBucket::availableIn(uint32_t tokens) {
+  int64_t now = nowNanos();
+  int64_t full = ATOMIC_LOAD(_full);
+  int64_t wait = (full > now ? full : now) + _interval * tokens - now - _tolerance;
+  return wait > 0 ? (wait + 999) / 1000 : 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// SlidingWindow Methods
+//
+void SlidingWindow::setLimit(uint32_t limit, micros_t windowMicros) {
+  if (windowMicros < 1) { windowMicros = 1; }
+  _limit = limit;
+  _window = windowMicros;
+  reset();
+}
+
+// window numbers are 32 bits and wrap (after 49.7 days of 1 ms windows), so they're compared as signed differences.
+// a limiter left idle for more than 2^31 windows holds a number that looks later than now, so a later window is only
+// believed if the clock has reached it.  Only called when the windows differ, so it rarely reads the clock
+bool SlidingWindow::isLater(uint32_t window, uint32_t than) {
+  if ((int32_t)(window - than) <= 0) {
+    return false;
+  }
+  uint32_t latest = Uptime::micros() / _window;
+  return (int32_t)(window - latest) <= 0;
+}
+
+void SlidingWindow::reset() {
+  ATOMIC_STORE(_current, 0);
+  ATOMIC_STORE(_previous, 0);
+}
+
+uint32_t SlidingWindow::estimate(micros_t now, int64_t state, int64_t previous) {
+  uint32_t window = now / _window;
+  uint64_t previousCount = windowOf(previous) == window ? countOf(previous) : 0;
+  micros_t left = _window - now % _window;
+  return previousCount * left / _window + countOf(state);
+}
+
+bool SlidingWindow::tryAcquire(uint32_t count) {
+  micros_t now = Uptime::micros();
+  uint32_t window = now / _window;
+  int64_t state = ATOMIC_LOAD(_current);
+  while (true) {
+    if (windowOf(state) != window) {
+      if (isLater(windowOf(state), window)) {
+        // we read the time before another thread moved on to a later window, count against that one, from its start
+        now = (now / _window + (int32_t)(windowOf(state) - window)) * _window;
+        window = windowOf(state);
+      } else {
+        // first event of a new window, the old count becomes the previous one if it was the window just before.
+        // publish it before the new window, so nobody sees the new window without it
+        int64_t previous = ATOMIC_LOAD(_previous);
+        int64_t nextPrevious = pack(window, windowOf(state) + 1 == window ? countOf(state) : 0);
+        while (windowOf(previous) != window && !isLater(windowOf(previous), window) &&
+               !ATOMIC_CAS(_previous, previous, nextPrevious)) {}
+        int64_t next = pack(window, 0);
+        if (ATOMIC_CAS(_current, state, next)) {
+          state = next;
+        }
+        continue;
+      }
+    }
+    if (estimate(now, state, ATOMIC_LOAD(_previous)) + count > _limit) {
+      return false;
+    }
+    if (ATOMIC_CAS(_current, state, pack(window, countOf(state) + count))) {
+      return true;
+    }
+  }
+}
+
+micros_t SlidingWindow::availableIn(uint32_t count) {
+  micros_t now = Uptime::micros();
+  uint32_t window = now / _window;
+  int64_t state = ATOMIC_LOAD(_current);
+  if (windowOf(state) != window && isLater(windowOf(state), window)) {
+    now = (now / _window + (int32_t)(windowOf(state) - window)) * _window;
+    window = windowOf(state);
+  }
+  uint64_t current = windowOf(state) == window ? countOf(state) : 0;
+  uint64_t previous = 0;
+  if (windowOf(state) == window) {
+    int64_t p = ATOMIC_LOAD(_previous);
+    previous = windowOf(p) == window ? countOf(p) : 0;
+  } else if (windowOf(state) + 1 == window) {
+    previous = countOf(state);
+  }
+
+  if (current + count > _limit) {
+    return _window - now % _window;  // not before the next window
+  }
+  if (previous == 0 || previous * (_window - now % _window) / _window + current + count <= _limit) {
+    return 0;
+  }
+  // the previous window's weight has to drop to (limit - current - count) / previous
+  micros_t left = (micros_t)(_limit - current - count) * _window / previous;
+  return (_window - now % _window) - left;
+}
+
+#if defined(RATELIMIT_ATOMIC) && defined(CLOCK_THREADS)
+
+#include <new>
+#include <thread>
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// ShardedTokenBucket Methods
+//
+ShardedTokenBucket::ShardedTokenBucket(uint32_t ratePerSec, uint32_t burst, uint16_t shards) {
+  if (shards == 0) {
+    shards = std::thread::hardware_concurrency();
+    if (shards == 0) { shards = 1; }
+  }
+  _count = shards;
+  // operator new only aligns to the cache line from C++17, so align by hand
+  _memory = new uint8_t[(_count + 1) * sizeof(Shard)];
+  uintptr_t aligned = ((uintptr_t)_memory + RATELIMIT_CACHE_LINE - 1) & ~(uintptr_t)(RATELIMIT_CACHE_LINE - 1);
+  _shards = (Shard*)aligned;
+  for (uint16_t i = 0; i < _count; i++) {
+    new (&_shards[i]) Shard();
+  }
+  setRate(ratePerSec, burst);
+}
+
+ShardedTokenBucket::~ShardedTokenBucket() {
+  for (uint16_t i = 0; i < _count; i++) {
+    _shards[i].~Shard();
+  }
+  delete[] _memory;
+}
+
+void ShardedTokenBucket::setRate(uint32_t ratePerSec, uint32_t burst) {
+  if (ratePerSec == 0) { ratePerSec = 1; }
+  if (burst == 0) { burst = 1; }
+  // every shard needs at least one token of rate and of burst, so small limits use fewer shards
+  uint32_t active = _count;
+  if (active > ratePerSec) { active = ratePerSec; }
+  if (active > burst) { active = burst; }
+  uint32_t rate = ratePerSec / active;
+  uint32_t shardBurst = burst / active;
+  for (uint16_t i = 0; i < active; i++) {
+    // spread the remainders so the shards add up to the whole
+    _shards[i].bucket.setRate(rate + (i < ratePerSec % active), shardBurst + (i < burst % active));
+  }
+  _active = active;
+}
+
+uint16_t ShardedTokenBucket::shard() {
+#if defined(__linux__)
+  int cpu = sched_getcpu();
+  if (cpu >= 0) {
+    return cpu % _active;
+  }
+#endif
+  static std::atomic<uint16_t> nextThread{0};
+  static thread_local uint16_t thread = nextThread++;
+  return thread % _active;
+}
+
+bool ShardedTokenBucket::tryAcquire(uint32_t tokens) {
+  uint16_t active = _active;
+  uint16_t mine = shard() % active;
+  if (_shards[mine].bucket.tryAcquire(tokens)) {
+    return true;
+  }
+  for (uint16_t i = 1; i < active; i++) {
+    if (_shards[(mine + i) % active].bucket.tryAcquire(tokens)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+micros_t ShardedTokenBucket::availableIn(uint32_t tokens) {
+  micros_t soonest = _shards[0].bucket.availableIn(tokens);
+  uint16_t active = _active;
+  for (uint16_t i = 1; i < active && soonest; i++) {
+    micros_t in = _shards[i].bucket.availableIn(tokens);
+    if (in < soonest) {
+      soonest = in;
+    }
+  }
+  return soonest;
+}
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef _RateLimit_
+#define _RateLimit_
+
+#include "Clock.h"
+#include "Timer.h"
+
+// Rate limiters on Uptime::micros().  On platforms with <atomic> they can be shared between threads:
+// checks are lock free, a single compare-and-swap when they succeed.
+//
+// Instead of polling, a caller that was refused can arm a CallbackTimer for when the limiter will accept it again, see wake().
+
+#if defined(__has_include)
+#if __has_include(<atomic>)
+#define RATELIMIT_ATOMIC
+#include <atomic>
+#endif
+#endif
+
+#if defined(RATELIMIT_ATOMIC)
+typedef std::atomic<int64_t> ratelimit_int64_t;
+#else
+typedef int64_t ratelimit_int64_t;
+#endif
+
+// TokenBucket allows ratePerSec tokens per second on average, and bursts of up to burst tokens.
+// It is implemented as a generic cell rate algorithm: the only state is the time at which the bucket would be full again.
+class TokenBucket {
+  public:
+    TokenBucket(uint32_t ratePerSec = 1, uint32_t burst = 1) { setRate(ratePerSec, burst); }
+
+    void setRate(uint32_t ratePerSec, uint32_t burst);
+    bool tryAcquire(uint32_t tokens = 1);
+    micros_t availableIn(uint32_t tokens = 1);  // micros until tryAcquire(tokens) would succeed, 0 if it would now
+    void reset();  // full again
+
+    // arm timer to call callback when tokens are available
+    void wake(CallbackTimer& timer, timerCallback_t callback, void* callbackData, uint32_t tokens = 1) {
+      timer.setMicros(availableIn(tokens), callback, callbackData);
+    }
+
+  private:
+    static int64_t nowNanos() { return Uptime::micros() * 1000; }
+
+    int64_t _interval;   // nanos per token
+    int64_t _tolerance;  // nanos of burst
+    ratelimit_int64_t _full{0};  // nanos uptime when the bucket is full again
+};
+
+// SlidingWindow allows up to limit events in any window of windowMicros, approximately:
+// the count of the previous fixed window is weighted by how much of it still overlaps the sliding window.
+class SlidingWindow {
+  public:
+    SlidingWindow(uint32_t limit = 1, micros_t windowMicros = Time::microsPerSec) { setLimit(limit, windowMicros); }
+
+    void setLimit(uint32_t limit, micros_t windowMicros);  // windows shorter than 1 us are taken as 1 us
+    bool tryAcquire(uint32_t count = 1);
+    micros_t availableIn(uint32_t count = 1);
+    void reset();
+
+    void wake(CallbackTimer& timer, timerCallback_t callback, void* callbackData, uint32_t count = 1) {
+      timer.setMicros(availableIn(count), callback, callbackData);
+    }
+
+  private:
+    uint32_t estimate(micros_t now, int64_t state, int64_t previous);
+    bool isLater(uint32_t window, uint32_t than);
+
+    // window number in the high 32 bits, count in the low 32 bits.  Window numbers wrap, so compare them with isLater()
+    static int64_t pack(uint32_t window, uint32_t count) { return (int64_t)(((uint64_t)window << 32) | count); }
+    static uint32_t windowOf(int64_t state) { return (uint64_t)state >> 32; }
+    static uint32_t countOf(int64_t state) { return (uint32_t)state; }
+
+    uint32_t _limit;
+    micros_t _window;
+    ratelimit_int64_t _current{0};
+    ratelimit_int64_t _previous{0};  // the previous window's count, tagged with the current window's number
+};
+
+#if defined(RATELIMIT_ATOMIC) && defined(CLOCK_THREADS)
+
+#if !defined(RATELIMIT_CACHE_LINE)
+#define RATELIMIT_CACHE_LINE 64
+#endif
+
+// ShardedTokenBucket splits a TokenBucket into one per core (or thread), each on its own cache line, so that
+// threads don't contend.  A thread whose shard is empty borrows from the others before giving up.
+class ShardedTokenBucket {
+  public:
+    ShardedTokenBucket(uint32_t ratePerSec = 1, uint32_t burst = 1, uint16_t shards = 0);  // 0 shards means one per core
+    ~ShardedTokenBucket();
+
+    void setRate(uint32_t ratePerSec, uint32_t burst);
+    bool tryAcquire(uint32_t tokens = 1);
+    micros_t availableIn(uint32_t tokens = 1);
+
+    void wake(CallbackTimer& timer, timerCallback_t callback, void* callbackData, uint32_t tokens = 1) {
+      timer.setMicros(availableIn(tokens), callback, callbackData);
+    }
+
+  private:
+    uint16_t shard();
+
+    struct alignas(RATELIMIT_CACHE_LINE) Shard {
+      TokenBucket bucket;
+    };
+    uint8_t* _memory;
+    Shard* _shards;
+    uint16_t _count;
+    std::atomic<uint16_t> _active{1};  // shards in use, fewer than _count when the rate or burst is small
+};
+
+#endif
+
+#endif
@@ -0,0 +1,86 @@
+#include "Simulator.h"
+#include "pprintf.h"
+
+micros_t Simulator::_now = 0;
+uint32_t Simulator::_events = 0;
+RTCClock* Simulator::_clock = nullptr;
+Print* Simulator::_tracePrint = nullptr;
+simulatorTrace_t Simulator::_trace = nullptr;
+void* Simulator::_traceData = nullptr;
+
+void Simulator::begin(micros_t startUptime) {
+  _now = startUptime;
+  _events = 0;
+  Uptime::setSource(&now);
+  Timer::setFireHook(&trace);
+}
+
+void Simulator::end() {
+  if (isRunning()) {
+    Uptime::setSource(nullptr);
+    Timer::setFireHook(nullptr);
+  }
+}
+
+micros_t Simulator::nextEvent() {
+  micros_t next = Timer::nextDeadline();
+  if (_clock) {
+    micros_t update = RTCClock::nextUpdate();
+    if (update && (next == 0 || update < next)) {
+      next = update;
+    }
+  }
+  return next;
+}
+
+bool Simulator::step() {
+  micros_t next = nextEvent();
+  if (next == 0) {
+    return false;
+  }
+  if (next > _now) {
+    _now = next;
+  }
+  runEvents();
+  return true;
+}
+
+void Simulator::runUntil(micros_t uptime) {
+  micros_t next = nextEvent();
+  while (next && next <= uptime) {
+    if (next > _now) {
+      _now = next;
+    }
+    runEvents();
+    next = nextEvent();
+  }
+  if (uptime > _now) {
+    _now = uptime;
+  }
+}
+
+void Simulator::runEvents() {
+  if (_clock) {
+    micros_t update = RTCClock::nextUpdate();
+    if (update && update <= _now) {
+      _clock->getMicros();  // lets the clock call updateTime()
+      trace(nullptr);
+    }
+  }
+  Timer::idle();  // traces each timer as it fires
+}
+
+void Simulator::trace(Timer* t) {
+  _events++;
+  if (_trace) {
+    (_trace)(_now, t, _traceData);
+  }
+  if (_tracePrint) {
+    pprintf(_tracePrint, "%lu.%06lu ", (unsigned long)(_now / Time::microsPerSec), (unsigned long)(_now % Time::microsPerSec));
+    if (t) {
+      pprintf(_tracePrint, "timer %lu ms\n", (unsigned long)t->durationMillis());
+    } else {
+      _tracePrint->println("clock update");
+    }
+  }
+}
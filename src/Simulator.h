@@ -0,0 +1,45 @@
+#ifndef _Simulator_
+#define _Simulator_
+
+#include "Clock.h"
+#include "Timer.h"
+
+// called for each event replayed by the Simulator, timer is nullptr for clock updates
+typedef void (*simulatorTrace_t)(micros_t uptime, Timer* timer, void* traceData);
+
+// Simulator runs Uptime (and therefore Timer and RTCClock) on virtual time.
+// Instead of waiting, it jumps straight to the next timer deadline (or clock update) and runs Timer::idle() there,
+// so long timer schedules replay as fast as the callbacks can run.
+// Events are replayed in a deterministic order for a given schedule.
+class Simulator {
+  public:
+    static void begin(micros_t startUptime = 0);  // switch Uptime to virtual time
+    static void end();                            // switch Uptime back to the hardware counter
+    static bool isRunning() { return Uptime::getSource() == &now; }
+
+    static micros_t now() { return _now; }  // current virtual uptime
+
+    static bool step();                       // jump to the next event and run it, false if there is nothing left to do
+    static void runUntil(micros_t uptime);    // run all events up to uptime, then leave the virtual time there
+    static void runFor(micros_t duration) { runUntil(_now + duration); }
+
+    static void setClock(RTCClock* clock) { _clock = clock; }  // include this clock's updateTime() calls in the schedule
+    static void setTrace(Print* p) { _tracePrint = p; }
+    static void setTrace(simulatorTrace_t trace, void* traceData) { _trace = trace; _traceData = traceData; }
+
+    static uint32_t eventCount() { return _events; }
+
+  private:
+    static micros_t nextEvent();
+    static void runEvents();
+    static void trace(Timer* t);  // also the Timer fire hook while the simulator runs
+
+    static micros_t _now;
+    static uint32_t _events;
+    static RTCClock* _clock;
+    static Print* _tracePrint;
+    static simulatorTrace_t _trace;
+    static void* _traceData;
+};
+
+#endif
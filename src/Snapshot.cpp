@@ -0,0 +1,158 @@
+#include "Snapshot.h"
+
+static void put64(uint8_t* b, int64_t v) {
+  for (uint8_t i = 0; i < 8; i++) { b[i] = (uint8_t)(v >> (8*i)); }
+}
+
+static void put32(uint8_t* b, uint32_t v) {
+  for (uint8_t i = 0; i < 4; i++) { b[i] = (uint8_t)(v >> (8*i)); }
+}
+
+static int64_t get64(const uint8_t* b) {
+  uint64_t v = 0;
+  for (uint8_t i = 0; i < 8; i++) { v |= (uint64_t)b[i] << (8*i); }
+  return (int64_t)v;
+}
+
+static uint32_t get32(const uint8_t* b) {
+  uint32_t v = 0;
+  for (uint8_t i = 0; i < 4; i++) { v |= (uint32_t)b[i] << (8*i); }
+  return v;
+}
+
+uint16_t TimerSnapshot::count() {
+  uint16_t n = 0;
+  for (Timer* t = Timer::first(); t; t = t->next()) {
+    if (t->_id) { n++; }
+  }
+  return n;
+}
+
+size_t TimerSnapshot::size() {
+  return headerSize + (RTCClock::_micros_offset ? clockSize : 0) + recordSize * count();
+}
+
+size_t TimerSnapshot::putHeader(uint8_t* b, RTCClock* rtc) {
+  b[0] = 'C';
+  b[1] = 'L';
+  b[2] = 'K';
+  b[3] = 'S';
+  b[4] = version;
+  b[5] = RTCClock::_micros_offset ? (hasClock | (rtc ? hasRTCOffset : 0)) : 0;
+  uint16_t n = count();
+  b[6] = n;
+  b[7] = n >> 8;
+  return headerSize;
+}
+
+size_t TimerSnapshot::putClock(uint8_t* b, RTCClock* rtc) {
+  micros_t rtcNow = rtc ? rtc->getRTCMicros() : 0;
+  micros_t up = Uptime::micros();
+  put64(b, rtc ? RTCClock::_utc_micros_time + up - RTCClock::_micros_offset - rtcNow : 0);  // utc ahead of the rtc
+  put64(b + 8, up - RTCClock::_last_update);                            // age of the last update
+  put64(b + 16, RTCClock::_update_interval);
+  return clockSize;
+}
+
+size_t TimerSnapshot::putTimer(uint8_t* b, Timer* t) {
+  uint8_t flags = t->_catchUp << timerCatchUpShift;
+  int64_t when = 0;
+  if (t->_repeatTimer) { flags |= timerRepeat; }
+  if (t->isPaused()) { flags |= timerPaused; }
+  if (t->_clockTime) {
+    flags |= timerClockTime;
+    when = t->isPaused() ? -t->_clockTime : t->_clockTime;  // seconds left when paused
+  } else if (t->_microsTime) {
+    when = t->remainingMicros();
+  }
+
+  put32(b, t->_id);
+  b[4] = flags;
+  put64(b + 5, when);
+  put64(b + 13, t->_microsDur);
+  return recordSize;
+}
+
+size_t TimerSnapshot::save(uint8_t* buffer, size_t len, RTCClock* rtc) {
+  if (len < size()) {
+    return 0;
+  }
+  uint8_t* b = buffer;
+  b += putHeader(b, rtc);
+  if (RTCClock::_micros_offset) {
+    b += putClock(b, rtc);
+  }
+  for (Timer* t = Timer::first(); t; t = t->next()) {
+    if (t->_id) {
+      b += putTimer(b, t);
+    }
+  }
+  return b - buffer;
+}
+
+size_t TimerSnapshot::save(Print& p, RTCClock* rtc) {
+  uint8_t b[clockSize];  // big enough for any section
+  size_t written = p.write(b, putHeader(b, rtc));
+  if (RTCClock::_micros_offset) {
+    written += p.write(b, putClock(b, rtc));
+  }
+  for (Timer* t = Timer::first(); t; t = t->next()) {
+    if (t->_id) {
+      written += p.write(b, putTimer(b, t));
+    }
+  }
+  return written;
+}
+
+bool TimerSnapshot::restore(const uint8_t* buffer, size_t len, snapshotLookup_t lookup, void* lookupData, RTCClock* rtc) {
+  if (len < headerSize || buffer[0] != 'C' || buffer[1] != 'L' || buffer[2] != 'K' || buffer[3] != 'S' || buffer[4] != version) {
+    return false;
+  }
+  uint8_t flags = buffer[5];
+  uint16_t n = buffer[6] | (buffer[7] << 8);
+  size_t clockLen = (flags & hasClock) ? clockSize : 0;
+  if (len < headerSize + clockLen + recordSize * n) {
+    return false;
+  }
+
+  const uint8_t* b = buffer + headerSize;
+  micros_t up = Uptime::micros();
+
+  if (clockLen) {
+    if (RTCClock::_micros_offset == 0) {
+      RTCClock::_last_update = up - get64(b + 8);
+      RTCClock::_update_interval = get64(b + 16);
+      if (rtc && (flags & hasRTCOffset)) {
+        // the rtc kept time while we were down, and the saved offset is the correction since its last update
+        micros_t rtcNow = rtc->getRTCMicros();
+        RTCClock::_micros_offset = Uptime::micros();
+        RTCClock::_utc_micros_time = rtcNow + get64(b);
+      }
+    }
+    b += clockLen;
+  }
+
+  for (uint16_t i = 0; i < n; i++, b += recordSize) {
+    Timer* t = lookup ? lookup(get32(b), lookupData) : nullptr;
+    if (!t) {
+      continue;
+    }
+    uint8_t timerFlags = b[4];
+    int64_t when = get64(b + 5);
+
+    t->cancel();
+    t->_repeatTimer = timerFlags & timerRepeat;
+    t->_catchUp = (timerCatchUp_t)((timerFlags >> timerCatchUpShift) & 0x03);
+    t->_microsDur = get64(b + 13);
+    // paused timers keep the time left as a negative number
+    if (timerFlags & timerClockTime) {
+      t->_clockTime = (timerFlags & timerPaused) ? -when : when;
+    } else if (timerFlags & timerPaused) {
+      t->_microsTime = -when;
+    } else {
+      t->_microsTime = up + when;
+    }
+    t->insert();
+  }
+  return true;
+}
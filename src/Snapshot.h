@@ -0,0 +1,56 @@
+#ifndef _Snapshot_
+#define _Snapshot_
+
+#include "Clock.h"
+#include "Timer.h"
+
+// returns the (already constructed) timer to restore the saved state into, or nullptr to skip it
+typedef Timer* (*snapshotLookup_t)(uint32_t id, void* lookupData);
+
+// TimerSnapshot saves the armed timers and the RTCClock state into a compact, versioned binary image,
+// for example before a reboot, and restores them in a single pass without allocating.
+//
+// Only timers with a non-zero id (see Timer::setId()) are saved.  Durations are saved as the time
+// remaining, and rebased on the current Uptime when restored.  Clock time deadlines are absolute and
+// are restored as is.  Paused timers of either kind save the time they have left and come back paused.
+//
+// The clock is saved as its update interval, the age of its last update and, if a clock with an RTC is passed to
+// save(), how far the shared time was from the RTC.  Restoring with the same clock reads the RTC and applies that
+// offset, so the time is right straight away, however long the system was down.  Without an RTC the time is not
+// restored, only the update discipline, because the saved time would be behind by the downtime.
+//
+// All values are little endian, so images can be moved between platforms.
+class TimerSnapshot {
+  public:
+    static size_t size();                             // bytes needed to save the current state
+    // returns bytes written, 0 if the buffer is too small.  rtc, if given, should have a battery backed RTC
+    static size_t save(uint8_t* buffer, size_t len, RTCClock* rtc = nullptr);
+    static size_t save(Print& p, RTCClock* rtc = nullptr);  // e.g. to a File
+
+    // restores the saved timers into the ones returned by lookup, returns false if the image is not valid.
+    // the clock is only restored if it has not been set since startup, and its time only if rtc is given
+    static bool restore(const uint8_t* buffer, size_t len, snapshotLookup_t lookup, void* lookupData = nullptr,
+                        RTCClock* rtc = nullptr);
+
+    static const uint8_t version = 3;  // 2: times in micros, catch up policy.  3: clock saved relative to the RTC
+
+  private:
+    static const size_t headerSize = 8;
+    static const size_t clockSize = 24;
+    static const size_t recordSize = 21;
+
+    static const uint8_t hasClock = 0x01;
+    static const uint8_t hasRTCOffset = 0x02;
+
+    static const uint8_t timerRepeat = 0x01;
+    static const uint8_t timerPaused = 0x02;
+    static const uint8_t timerClockTime = 0x04;
+    static const uint8_t timerCatchUpShift = 3;  // 2 bits of timerCatchUp_t
+
+    static uint16_t count();
+    static size_t putHeader(uint8_t* b, RTCClock* rtc);
+    static size_t putClock(uint8_t* b, RTCClock* rtc);
+    static size_t putTimer(uint8_t* b, Timer* t);
+};
+
+#endif
@@ -0,0 +1,337 @@
+#include "TZifZone.h"
+
+#if defined(TZIF_ZONES)
+
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "TimePoint.h"
+
+TZifZone TZifZone::_cache[TZIF_CACHE_SIZE];
+uint8_t TZifZone::_cached = 0;
+const char* TZifZone::_directory = "/usr/share/zoneinfo";
+#if defined(CLOCK_THREADS)
+std::mutex TZifZone::_lock;
+#endif
+
+static const size_t headerSize = 44;
+static const size_t typeSize = 6;
+
+static uint32_t get32(const uint8_t* b) {
+  return ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | b[3];
+}
+
+static int64_t get64(const uint8_t* b) {
+  return (int64_t)(((uint64_t)get32(b) << 32) | get32(b + 4));
+}
+
+TZifZone* TZifZone::get(const char* name) {
+  if (!name || strlen(name) >= sizeof(_cache[0]._name)) {
+    return nullptr;
+  }
+#if defined(CLOCK_THREADS)
+  std::lock_guard<std::mutex> guard(_lock);
+#endif
+  for (uint8_t i = 0; i < _cached; i++) {
+    if (strcmp(_cache[i]._name, name) == 0) {
+      return &_cache[i];
+    }
+  }
+  if (_cached >= TZIF_CACHE_SIZE) {
+    return nullptr;
+  }
+
+  char path[256];
+  snprintf(path, sizeof(path), "%s/%s", _directory, name);
+  TZifZone* zone = &_cache[_cached];
+  if (!zone->load(path)) {
+    return nullptr;
+  }
+  strcpy(zone->_name, name);
+  _cached++;
+  return zone;
+}
+
+void TZifZone::setDirectory(const char* dir) {
+  _directory = dir;
+}
+
+bool TZifZone::load(const char* path) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < headerSize) {
+    close(fd);
+    return false;
+  }
+  size_t len = st.st_size;
+  void* map = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+
+  const uint8_t* b = (const uint8_t*)map;
+  if (memcmp(b, "TZif", 4) != 0) {
+    munmap(map, len);
+    return false;
+  }
+  uint8_t version = b[4];
+
+  // header counts: isutcnt, isstdcnt, leapcnt, timecnt, typecnt, charcnt
+  size_t pos = 0;
+  uint8_t timeSize = 4;
+  uint8_t leapSize = 8;
+  while (true) {
+    if (pos + headerSize > len) {
+      munmap(map, len);
+      return false;
+    }
+    const uint8_t* h = b + pos;
+    uint32_t isut = get32(h + 20);
+    uint32_t isstd = get32(h + 24);
+    uint32_t leap = get32(h + 28);
+    uint32_t times = get32(h + 32);
+    uint32_t types = get32(h + 36);
+    uint32_t chars = get32(h + 40);
+    size_t data = (size_t)times * timeSize + times + (size_t)types * typeSize + chars + (size_t)leap * leapSize + isstd + isut;
+    if (types == 0 || pos + headerSize + data > len) {
+      munmap(map, len);
+      return false;
+    }
+
+    if (version >= '2' && timeSize == 4) {
+      // skip the 32 bit data, the 64 bit version follows
+      pos += headerSize + data;
+      timeSize = 8;
+      leapSize = 12;
+      continue;
+    }
+
+    _timeSize = timeSize;
+    _timeCount = times;
+    _typeCount = types;
+    _charCount = chars;
+    _times = h + headerSize;
+    _indices = _times + (size_t)times * timeSize;
+    _types = _indices + times;
+    _chars = (const char*)(_types + (size_t)types * typeSize);
+
+    const char* footer = (const char*)(h + headerSize + data);
+    const char* end = (const char*)(b + len);
+    if (timeSize == 8 && footer + 1 < end && *footer == '\n') {
+      footer++;
+      const char* nl = (const char*)memchr(footer, '\n', end - footer);
+      if (nl && nl > footer) {
+        _footer = footer;
+        _footerLen = nl - footer;
+      }
+    }
+    break;
+  }
+
+  _map = b;
+  _mapLen = len;
+  return true;
+}
+
+int32_t TZifZone::transition(time_t utc) {
+  int64_t t = utc;
+  int32_t lo = 0;
+  int32_t hi = _timeCount;
+  while (lo < hi) {
+    int32_t mid = lo + (hi - lo) / 2;
+    int64_t at = _timeSize == 8 ? get64(_times + (size_t)mid * 8) : (int32_t)get32(_times + (size_t)mid * 4);
+    if (at <= t) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo - 1;
+}
+
+const uint8_t* TZifZone::type(time_t utc) {
+  int32_t i = transition(utc);
+  uint8_t index = i < 0 ? 0 : _indices[i];
+  if (index >= _typeCount) {
+    index = 0;
+  }
+  return _types + (size_t)index * typeSize;
+}
+
+// the footer rule applies after the last transition
+bool TZifZone::useRule(time_t utc) {
+  parseRule();
+  return _hasRule && (_timeCount == 0 || transition(utc) == (int32_t)_timeCount - 1);
+}
+
+stime_t TZifZone::offset(time_t utc) {
+  if (useRule(utc)) {
+    return ruleIsDST(utc) ? _dstOffset : _stdOffset;
+  }
+  return (int32_t)get32(type(utc));
+}
+
+bool TZifZone::isDST(time_t utc) {
+  if (useRule(utc)) {
+    return ruleIsDST(utc);
+  }
+  return type(utc)[4];
+}
+
+const char* TZifZone::abbrev(time_t utc) {
+  if (useRule(utc)) {
+    return ruleIsDST(utc) ? _dstAbbrev : _stdAbbrev;
+  }
+  uint8_t i = type(utc)[5];
+  return i < _charCount ? _chars + i : "";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// POSIX TZ rules, only the Mm.w.d form of dates (which is what zic writes)
+
+static const char* parseAbbrev(const char* p, const char* end, char* abbrev, size_t len) {
+  size_t n = 0;
+  if (p < end && *p == '<') {
+    p++;
+    while (p < end && *p != '>') {
+      if (n + 1 < len) { abbrev[n++] = *p; }
+      p++;
+    }
+    if (p >= end) { return nullptr; }
+    p++;
+  } else {
+    while (p < end && ((*p >= 'A' && *p <= 'Z') || (*p >= 'a' && *p <= 'z'))) {
+      if (n + 1 < len) { abbrev[n++] = *p; }
+      p++;
+    }
+  }
+  abbrev[n] = 0;
+  return n ? p : nullptr;
+}
+
+static const char* parseNumber(const char* p, const char* end, int32_t* v) {
+  if (p >= end || *p < '0' || *p > '9') { return nullptr; }
+  int32_t n = 0;
+  while (p < end && *p >= '0' && *p <= '9') {
+    n = n * 10 + (*p - '0');
+    p++;
+  }
+  *v = n;
+  return p;
+}
+
+// [+-]hh[:mm[:ss]], in seconds
+static const char* parseTime(const char* p, const char* end, int32_t* secs) {
+  int32_t sign = 1;
+  if (p < end && (*p == '+' || *p == '-')) {
+    sign = *p == '-' ? -1 : 1;
+    p++;
+  }
+  int32_t h = 0, m = 0, s = 0;
+  p = parseNumber(p, end, &h);
+  if (p && p < end && *p == ':') {
+    p = parseNumber(p + 1, end, &m);
+    if (p && p < end && *p == ':') {
+      p = parseNumber(p + 1, end, &s);
+    }
+  }
+  if (p) {
+    *secs = sign * (h * Time::secsPerHour + m * Time::secsPerMin + s);
+  }
+  return p;
+}
+
+void TZifZone::parseRule() {
+#if defined(CLOCK_THREADS)
+  std::call_once(_ruleOnce, [this]() {
+#else
+  if (_ruleParsed) { return; }
+  _ruleParsed = true;
+  {
+#endif
+    _hasRule = false;
+    if (!_footer) { return; }
+    const char* p = _footer;
+    const char* end = _footer + _footerLen;
+    int32_t off = 0;
+
+    p = parseAbbrev(p, end, _stdAbbrev, sizeof(_stdAbbrev));
+    if (p) { p = parseTime(p, end, &off); }
+    if (!p) { return; }
+    _stdOffset = -off;  // POSIX offsets are west of Greenwich
+    _dstOffset = _stdOffset;
+    _ruleHasDST = false;
+
+    if (p < end) {
+      p = parseAbbrev(p, end, _dstAbbrev, sizeof(_dstAbbrev));
+      if (!p) { return; }
+      _dstOffset = _stdOffset + Time::secsPerHour;
+      if (p < end && *p != ',') {
+        p = parseTime(p, end, &off);
+        if (!p) { return; }
+        _dstOffset = -off;
+      }
+      RuleDate* dates[2] = { &_dstStart, &_dstEnd };
+      for (uint8_t i = 0; i < 2; i++) {
+        int32_t m = 0, w = 0, d = 0;
+        if (p + 1 >= end || p[0] != ',' || p[1] != 'M') { return; }
+        p = parseNumber(p + 2, end, &m);
+        if (p && p < end && *p == '.') { p = parseNumber(p + 1, end, &w); } else { p = nullptr; }
+        if (p && p < end && *p == '.') { p = parseNumber(p + 1, end, &d); } else { p = nullptr; }
+        if (!p || m < 1 || m > 12 || w < 1 || w > 5 || d > 6) { return; }
+        dates[i]->month = m;
+        dates[i]->week = w;
+        dates[i]->dow = d;
+        dates[i]->time = 2 * Time::secsPerHour;
+        if (p < end && *p == '/') {
+          p = parseTime(p + 1, end, &dates[i]->time);
+          if (!p) { return; }
+        }
+      }
+      _ruleHasDST = true;
+    }
+    _hasRule = (p == end);
+#if defined(CLOCK_THREADS)
+  });
+#else
+  }
+#endif
+}
+
+// utc time of a rule date in the given year, time is local time at the offset in effect before the change
+static int64_t ruleTime(uint16_t year, uint8_t month, uint8_t week, uint8_t dow, int32_t time, stime_t offset) {
+  int32_t first = TimePoint::daysFromCivil(year, month, 1);
+  int32_t firstDow = TimePoint::weekdayFromDays(first) - 1;  // 0 is Sunday, like POSIX
+  int32_t day = (dow - firstDow + 7) % 7 + (week - 1) * 7;
+  uint16_t nextYear = month == 12 ? year + 1 : year;
+  uint8_t nextMonth = month == 12 ? 1 : month + 1;
+  int32_t monthDays = TimePoint::daysFromCivil(nextYear, nextMonth, 1) - first;
+  while (day >= monthDays) {  // week 5 means the last one
+    day -= 7;
+  }
+  return (int64_t)(first + day) * Time::secsPerDay + time - offset;
+}
+
+bool TZifZone::ruleIsDST(time_t utc) {
+  if (!_ruleHasDST) {
+    return false;
+  }
+  uint16_t year = TimePoint((micros_t)utc * Time::microsPerSec).year();
+  int64_t start = ruleTime(year, _dstStart.month, _dstStart.week, _dstStart.dow, _dstStart.time, _stdOffset);
+  int64_t end = ruleTime(year, _dstEnd.month, _dstEnd.week, _dstEnd.dow, _dstEnd.time, _dstOffset);
+  int64_t t = utc;
+  if (start < end) {
+    return t >= start && t < end;
+  } else {
+    return t >= start || t < end;  // southern hemisphere
+  }
+}
+
+#endif // TZIF_ZONES
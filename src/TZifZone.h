@@ -0,0 +1,88 @@
+#ifndef _TZifZone_
+#define _TZifZone_
+
+#include "Clock.h"
+
+// TZifZone is a LocalZone read from a TZif file of the zoneinfo database (RFC 8536), as found in /usr/share/zoneinfo:
+//
+//   clock.setZone(TZifZone::get("Europe/Paris"));
+//
+// The file is memory mapped and used in place: loading only checks the headers, offsets are found by a binary search
+// of the transition table, and the POSIX TZ rule for times after the last transition is parsed the first time it is needed.
+// Zones are cached for the life of the process, so every clock in the same zone shares one TZifZone.
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TZIF_ZONES
+#endif
+
+#if defined(TZIF_ZONES)
+
+#if defined(CLOCK_THREADS)
+#include <mutex>
+#endif
+
+#if !defined(TZIF_CACHE_SIZE)
+#define TZIF_CACHE_SIZE 32  // zones that can be loaded at once
+#endif
+
+class TZifZone : public LocalZone {
+  public:
+    static TZifZone* get(const char* name);     // e.g. "America/Los_Angeles", nullptr if it can't be loaded
+    static void setDirectory(const char* dir);  // where to find the zones, default is /usr/share/zoneinfo
+
+    virtual stime_t offset(time_t utc);
+    const char* abbrev(time_t utc);  // e.g. "PDT"
+    bool isDST(time_t utc);
+    const char* name() { return _name; }
+
+  private:
+    bool load(const char* path);
+    int32_t transition(time_t utc);   // index of the last transition at or before utc, -1 if before the first one
+    const uint8_t* type(time_t utc);  // the 6 byte local time type in effect
+    bool useRule(time_t utc);
+    void parseRule();
+    bool ruleIsDST(time_t utc);
+
+    char _name[64];
+    const uint8_t* _map = nullptr;
+    size_t _mapLen = 0;
+
+    // tables in the mapped file, 64 bit times for version 2 and later
+    uint8_t _timeSize = 4;
+    uint32_t _timeCount = 0;
+    uint32_t _typeCount = 0;
+    uint32_t _charCount = 0;
+    const uint8_t* _times = nullptr;
+    const uint8_t* _indices = nullptr;
+    const uint8_t* _types = nullptr;
+    const char* _chars = nullptr;
+    const char* _footer = nullptr;  // POSIX TZ string for times after the last transition
+    size_t _footerLen = 0;
+
+    // the footer rule, e.g. "PST8PDT,M3.2.0,M11.1.0"
+    struct RuleDate { uint8_t month; uint8_t week; uint8_t dow; int32_t time; };
+#if defined(CLOCK_THREADS)
+    std::once_flag _ruleOnce;
+#else
+    bool _ruleParsed = false;
+#endif
+    bool _hasRule = false;    // false if there is no footer or it can't be parsed
+    bool _ruleHasDST = false;
+    stime_t _stdOffset = 0;
+    stime_t _dstOffset = 0;
+    char _stdAbbrev[8];
+    char _dstAbbrev[8];
+    RuleDate _dstStart;
+    RuleDate _dstEnd;
+
+    static TZifZone _cache[TZIF_CACHE_SIZE];
+    static uint8_t _cached;
+    static const char* _directory;
+#if defined(CLOCK_THREADS)
+    static std::mutex _lock;
+#endif
+};
+
+#endif // TZIF_ZONES
+
+#endif
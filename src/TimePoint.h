@@ -0,0 +1,198 @@
+#ifndef _TimePoint_
+#define _TimePoint_
+
+#include "Clock.h"
+
+// Duration and TimePoint are plain 8 byte values holding a micros_t, with no vtable and no zone.
+// Use them in hot code and in arrays; use Time (and its descendents) when you need a polymorphic or zoned time.
+// TimePoint does not know its epoch, by convention it is either UTC (see utc()) or Uptime (see uptime()).
+//
+// Where the standard library has <chrono>, both convert to and from std::chrono types for free,
+// and ChronoUptime and ChronoClock meet the standard Clock requirements.
+
+#if defined(__has_include)
+#if __has_include(<chrono>)
+#define TIMEPOINT_CHRONO
+#include <chrono>
+#include <type_traits>
+#endif
+#endif
+
+// calendar math needs relaxed constexpr
+#if __cplusplus >= 201402L
+#define TIMEPOINT_CONSTEXPR constexpr
+#else
+#define TIMEPOINT_CONSTEXPR inline
+#endif
+
+class Duration {
+  public:
+    constexpr Duration() : _micros(0) {}
+    constexpr explicit Duration(micros_t us) : _micros(us) {}
+
+    static constexpr Duration micros(micros_t us) { return Duration(us); }
+    static constexpr Duration millis(millis_t ms) { return Duration(ms * Time::microsPerMilli); }
+    static constexpr Duration seconds(stime_t s) { return Duration(s * Time::microsPerSec); }
+
+    constexpr micros_t getMicros() const { return _micros; }
+    constexpr millis_t getMillis() const { return _micros / Time::microsPerMilli; }
+    constexpr stime_t getSeconds() const { return _micros / Time::microsPerSec; }
+
+    constexpr Duration operator+(Duration d) const { return Duration(_micros + d._micros); }
+    constexpr Duration operator-(Duration d) const { return Duration(_micros - d._micros); }
+    constexpr Duration operator-() const { return Duration(-_micros); }
+    constexpr Duration operator*(int64_t n) const { return Duration(_micros * n); }
+    constexpr Duration operator/(int64_t n) const { return Duration(_micros / n); }
+    constexpr int64_t operator/(Duration d) const { return _micros / d._micros; }
+    constexpr Duration operator%(Duration d) const { return Duration(_micros % d._micros); }
+    TIMEPOINT_CONSTEXPR Duration& operator+=(Duration d) { _micros += d._micros; return *this; }
+    TIMEPOINT_CONSTEXPR Duration& operator-=(Duration d) { _micros -= d._micros; return *this; }
+
+    constexpr bool operator==(Duration d) const { return _micros == d._micros; }
+    constexpr bool operator!=(Duration d) const { return _micros != d._micros; }
+    constexpr bool operator<(Duration d) const { return _micros < d._micros; }
+    constexpr bool operator<=(Duration d) const { return _micros <= d._micros; }
+    constexpr bool operator>(Duration d) const { return _micros > d._micros; }
+    constexpr bool operator>=(Duration d) const { return _micros >= d._micros; }
+
+#if defined(TIMEPOINT_CHRONO)
+    typedef std::chrono::duration<micros_t, std::micro> chrono_t;
+
+    template <class Rep, class Period>
+    constexpr Duration(std::chrono::duration<Rep, Period> d) : _micros(std::chrono::duration_cast<chrono_t>(d).count()) {}
+    constexpr chrono_t toChrono() const { return chrono_t(_micros); }
+    constexpr operator chrono_t() const { return toChrono(); }
+#endif
+
+  private:
+    micros_t _micros;
+};
+
+class TimePoint {
+  public:
+    constexpr TimePoint() : _micros(0) {}
+    constexpr explicit TimePoint(micros_t us) : _micros(us) {}
+    explicit TimePoint(Time& t) : _micros(t.getMicros()) {}
+
+    static TimePoint uptime() { return TimePoint(Uptime::micros()); }
+    static TimePoint utc() { return TimePoint(RTCClock::utcMicros()); }
+
+    void setTime(Time& t) const { t.setMicros(_micros); }
+
+    constexpr micros_t getMicros() const { return _micros; }
+    constexpr millis_t getMillis() const { return floorDiv(_micros, Time::microsPerMilli); }
+    constexpr time_t getSeconds() const { return floorDiv(_micros, Time::microsPerSec); }
+    constexpr uint32_t fracMicros() const { return _micros - floorDiv(_micros, Time::microsPerSec) * Time::microsPerSec; }
+
+    constexpr Duration sinceEpoch() const { return Duration(_micros); }
+
+    // calendar fields, in the same ranges as the Time accessors
+    constexpr int32_t days() const { return floorDiv(_micros, Time::microsPerDay); }  // days since 1970-01-01
+    constexpr uint32_t secondOfDay() const { return (_micros - days() * Time::microsPerDay) / Time::microsPerSec; }
+    constexpr uint8_t hour() const { return secondOfDay() / Time::secsPerHour; }
+    constexpr uint8_t minute() const { return secondOfDay() % Time::secsPerHour / Time::secsPerMin; }
+    constexpr uint8_t second() const { return secondOfDay() % Time::secsPerMin; }
+    constexpr bool isAM() const { return hour() < 12; }
+    constexpr uint8_t hourFormat12() const { return hour() % 12 ? hour() % 12 : 12; }
+    constexpr uint8_t weekday() const { return weekdayFromDays(days()); }  // 1 is Sunday
+    TIMEPOINT_CONSTEXPR uint16_t year() const { uint16_t y = 0; uint8_t m = 0, d = 0; civilFromDays(days(), y, m, d); return y; }
+    TIMEPOINT_CONSTEXPR uint8_t month() const { uint16_t y = 0; uint8_t m = 0, d = 0; civilFromDays(days(), y, m, d); return m; }
+    TIMEPOINT_CONSTEXPR uint8_t day() const { uint16_t y = 0; uint8_t m = 0, d = 0; civilFromDays(days(), y, m, d); return d; }
+    TIMEPOINT_CONSTEXPR void date(uint16_t& y, uint8_t& m, uint8_t& d) const { civilFromDays(days(), y, m, d); }
+
+    static TIMEPOINT_CONSTEXPR TimePoint fromDateTime(uint16_t y, uint8_t m = 1, uint8_t d = 1, uint8_t hr = 0, uint8_t min = 0, uint8_t sec = 0) {
+      // in micros_t throughout, time_t is unsigned 32 bits on some platforms
+      return TimePoint((micros_t)daysFromCivil(y, m, d) * Time::microsPerDay +
+                       ((micros_t)hr * Time::secsPerHour + (micros_t)min * Time::secsPerMin + sec) * Time::microsPerSec);
+    }
+
+    constexpr TimePoint operator+(Duration d) const { return TimePoint(_micros + d.getMicros()); }
+    constexpr TimePoint operator-(Duration d) const { return TimePoint(_micros - d.getMicros()); }
+    constexpr Duration operator-(TimePoint t) const { return Duration(_micros - t._micros); }
+    TIMEPOINT_CONSTEXPR TimePoint& operator+=(Duration d) { _micros += d.getMicros(); return *this; }
+    TIMEPOINT_CONSTEXPR TimePoint& operator-=(Duration d) { _micros -= d.getMicros(); return *this; }
+
+    constexpr bool operator==(TimePoint t) const { return _micros == t._micros; }
+    constexpr bool operator!=(TimePoint t) const { return _micros != t._micros; }
+    constexpr bool operator<(TimePoint t) const { return _micros < t._micros; }
+    constexpr bool operator<=(TimePoint t) const { return _micros <= t._micros; }
+    constexpr bool operator>(TimePoint t) const { return _micros > t._micros; }
+    constexpr bool operator>=(TimePoint t) const { return _micros >= t._micros; }
+
+    // days since 1970-01-01 to and from a proleptic Gregorian date (see http://howardhinnant.github.io/date_algorithms.html)
+    static TIMEPOINT_CONSTEXPR void civilFromDays(int32_t z, uint16_t& y, uint8_t& m, uint8_t& d) {
+      z += 719468;
+      const int32_t era = (z >= 0 ? z : z - 146096) / 146097;
+      const uint32_t doe = z - era * 146097;
+      const uint32_t yoe = (doe - doe/1460 + doe/36524 - doe/146096) / 365;
+      const uint32_t doy = doe - (365*yoe + yoe/4 - yoe/100);
+      const uint32_t mp = (5*doy + 2)/153;
+      d = doy - (153*mp + 2)/5 + 1;
+      m = mp < 10 ? mp + 3 : mp - 9;
+      y = yoe + era * 400 + (m <= 2);
+    }
+
+    static TIMEPOINT_CONSTEXPR int32_t daysFromCivil(uint16_t y, uint8_t m, uint8_t d) {
+      int32_t yy = (int32_t)y - (m <= 2);
+      const int32_t era = (yy >= 0 ? yy : yy - 399) / 400;
+      const uint32_t yoe = yy - era * 400;
+      const uint32_t doy = (153*(m > 2 ? m - 3 : m + 9) + 2)/5 + d - 1;
+      const uint32_t doe = yoe * 365 + yoe/4 - yoe/100 + doy;
+      return era * 146097 + (int32_t)doe - 719468;
+    }
+
+    static constexpr uint8_t weekdayFromDays(int32_t z) { return (z >= -4 ? (z + 4) % 7 : (z + 5) % 7 + 6) + 1; }  // 1970-01-01 was a Thursday
+
+#if defined(TIMEPOINT_CHRONO)
+    template <class C>
+    using chrono_t = std::chrono::time_point<C, Duration::chrono_t>;
+
+    template <class C, class D>
+    constexpr TimePoint(std::chrono::time_point<C, D> t) : _micros(Duration(t.time_since_epoch()).getMicros()) {}
+
+    template <class C>
+    constexpr chrono_t<C> toChrono() const { return chrono_t<C>(Duration::chrono_t(_micros)); }
+#endif
+
+  private:
+    static constexpr micros_t floorDiv(micros_t a, micros_t b) { return (a >= 0 ? a : a - b + 1) / b; }
+
+    micros_t _micros;
+};
+
+#if defined(TIMEPOINT_CHRONO)
+static_assert(sizeof(TimePoint) == 8 && std::is_trivially_copyable<TimePoint>::value, "TimePoint must be a plain 8 byte value");
+static_assert(sizeof(Duration) == 8 && std::is_trivially_copyable<Duration>::value, "Duration must be a plain 8 byte value");
+
+// std::chrono clock over Uptime, steady
+// note: Uptime and Clock can't be used as std::chrono clocks directly, because Time::now() already means seconds
+struct ChronoUptime {
+  typedef micros_t rep;
+  typedef std::micro period;
+  typedef Duration::chrono_t duration;
+  typedef std::chrono::time_point<ChronoUptime> time_point;
+  static constexpr bool is_steady = true;
+
+  static time_point now() { return time_point(duration(Uptime::micros())); }
+};
+
+// std::chrono clock over the shared RTCClock UTC time, with the same epoch as std::chrono::system_clock
+struct ChronoClock {
+  typedef micros_t rep;
+  typedef std::micro period;
+  typedef Duration::chrono_t duration;
+  typedef std::chrono::time_point<ChronoClock> time_point;
+  static constexpr bool is_steady = false;
+
+  static time_point now() { return time_point(duration(RTCClock::utcMicros())); }
+
+  static std::chrono::system_clock::time_point toSys(time_point t) {
+    return std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(t.time_since_epoch()));
+  }
+  static time_point fromSys(std::chrono::system_clock::time_point t) {
+    return time_point(std::chrono::duration_cast<duration>(t.time_since_epoch()));
+  }
+};
+#endif
+
+#endif
@@ -1,10 +1,15 @@
 #include "Timer.h"
 #include "Clock.h"
 #include "pprintf.h"
+#include "EventTrace.h"
 
 Clock timerClock;
 
 Timer* Timer::_first = nullptr;
+void (*Timer::_idleHook)() = nullptr;
+Histogram* Timer::_jitter = nullptr;
+timerChangeHook_t Timer::_changeHook = nullptr;
+timerFireHook_t Timer::_fireHook = nullptr;
 
 Timer::~Timer() {
   remove();
@@ -14,16 +19,20 @@ Timer::~Timer() {
 void Timer::setClockTime(time_t clockTimeSet) {
   cancel();
   _clockTime = clockTimeSet;
-  _millisDur = (clockTimeSet-timerClock.now())*1000;
+  _microsDur = (clockTimeSet-timerClock.now())*Time::microsPerSec;
   insert();
 }
 
 void Timer::setMillis(millis_t millisDuration, bool repeat) {
+  setMicros(millisDuration*Time::microsPerMilli, repeat);
+}
+
+void Timer::setMicros(micros_t microsDuration, bool repeat) {
   cancel();
   _clockTime = 0;
   _repeatTimer = repeat;
-  _millisDur = millisDuration;
-  _millisTime = Uptime::millis() + _millisDur;
+  _microsDur = microsDuration;
+  _microsTime = Uptime::micros() + _microsDur;
   insert();
 }
 
@@ -32,24 +41,28 @@ void Timer::setSecs(time_t secs, bool repeat) {
 }
 
 millis_t Timer::remainingMillis() {
-  millis_t remainingMillis = 0;
-  if (_millisTime) {
+  return remainingMicros()/Time::microsPerMilli;
+}
+
+micros_t Timer::remainingMicros() {
+  micros_t remainingMicros = 0;
+  if (_microsTime) {
     if (isPaused()) {
-      return -_millisTime;
+      return -_microsTime;
     } else {
-      return (_millisTime - Uptime::millis());
+      return (_microsTime - Uptime::micros());
     }
   } else if (_clockTime) {
-    // todo make this more accurate using the difference between millis() and now()
-    return remainingSecs() * 1000;
+    // todo make this more accurate using the difference between micros() and now()
+    return remainingSecs() * Time::microsPerSec;
   }
-  return remainingMillis;
+  return remainingMicros;
 }
 
 time_t Timer::remainingSecs() {
   millis_t remainingSecs = 0;
-  if (_millisTime) {
-    return remainingMillis()/1000;
+  if (_microsTime) {
+    return remainingMicros()/Time::microsPerSec;
   } else if (_clockTime) {
     if (isPaused()) {
       return -_clockTime;
@@ -65,23 +78,35 @@ time_t Timer::timeInSecs() {
 }
 
 millis_t Timer::timeInMillis() {
-  return Uptime::millis()+remainingMillis();
+  return timeInMicros()/Time::microsPerMilli;
+}
+
+micros_t Timer::timeInMicros() {
+  return Uptime::micros()+remainingMicros();
 }
 
 time_t Timer::durationSecs() {
-  return _millisDur/1000;
+  return _microsDur/Time::microsPerSec;
 }
 
 millis_t Timer::durationMillis() {
-    return _millisDur;
+    return _microsDur/Time::microsPerMilli;
+}
+
+micros_t Timer::durationMicros() {
+    return _microsDur;
 }
 
 bool Timer::hasPassed() {
+  return hasPassed(Uptime::micros());
+}
+
+bool Timer::hasPassed(micros_t now) {
 
   if (isPaused()) { return false; }
 
-  if (_millisTime) {
-    if (Uptime::millis() >= _millisTime) {
+  if (_microsTime) {
+    if (now >= _microsTime) {
       return true;
     }
   } else if (_clockTime) {
@@ -93,15 +118,15 @@ bool Timer::hasPassed() {
 }
 
 bool Timer::isRunning() {
-  return (_millisTime > 0) || (_clockTime > 0);
+  return (_microsTime > 0) || (_clockTime > 0);
 }
 
 void Timer::cancel() {
-  _millisTime = 0;
+  remove();  // first, so the change hook can still see when it was due
+  _microsTime = 0;
   _clockTime = 0;
-  _millisDur = 0;
+  _microsDur = 0;
   _repeatTimer = 0;
-  remove();
 }
 
 void Timer::pause() {
@@ -110,48 +135,132 @@ void Timer::pause() {
     return;
   }
 
-  if (_millisTime) {
-    _millisTime = -(_millisTime - Uptime::millis());
+  if (_microsTime) {
+    _microsTime = -(_microsTime - Uptime::micros());
   } else if (_clockTime) {
     _clockTime = -(_clockTime - timerClock.now());
   }
+  if (_changeHook) {
+    _changeHook(this, false);
+  }
 }
 
 void Timer::resume() {
   if (!isPaused()) {
     return;
   }
-  if (_millisTime) {
-    _millisTime = Uptime::millis() - _millisTime;
+  if (_microsTime) {
+    _microsTime = Uptime::micros() - _microsTime;
   } else if (_clockTime) {
     _clockTime = timerClock.now() - _clockTime;
   }
+  if (_changeHook) {
+    _changeHook(this, true);
+  }
 }
 
 bool Timer::isPaused() {
-  return (_millisTime < 0) || (_clockTime < 0);
+  return (_microsTime < 0) || (_clockTime < 0);
 }
 
 void Timer::idle() {
   Timer* t = _first;
+  micros_t now = Uptime::micros();
   while (t) {
-    if (t->hasPassed()) {
+    if (t->hasPassed(now)) {
       //pu.debugf("timer has passed %d\n",t);
       Timer* nextup = t->_next;
       t->remove();
+      CLOCK_TRACE_EVENT(traceTimerFire, t->_id ? t->_id : (uint32_t)(uintptr_t)t);
+      if (_jitter && t->_microsTime) {
+        micros_t late = now - t->_microsTime;
+        _jitter->add(late > 0xffffffff ? 0xffffffff : (uint32_t)late);
+      }
+      if (_fireHook) {
+        _fireHook(t);
+      }
       t->callback();
       if (t->_repeatTimer) {
         //console.debugf("reinserting repeat timer %d\n", t);
-        t->_millisTime += t->_millisDur;
+        t->rearm(now);
         t->insert();
       }
+      now = Uptime::micros();
       t = nextup;
     } else {
       t = t->_next;
     }
   }
+  if (_idleHook) {
+    _idleHook();
+  }
+}
+
+// the next deadline is always relative to the last one, so repeating timers don't drift
+void Timer::rearm(micros_t now) {
+  _microsTime += _microsDur;
+  if (_microsTime > now || _microsDur <= 0) {
+    return;
+  }
+  switch (_catchUp) {
+    case timerFireAll:
+      break;
+    case timerSkipMissed:
+      _microsTime = now + _microsDur;
+      break;
+    case timerRealign:
+      _microsTime += ((now - _microsTime)/_microsDur + 1) * _microsDur;
+      break;
+  }
+}
+
+micros_t Timer::nextDeadline() {
+  micros_t soonest = 0;
+  micros_t now = Uptime::micros();
+  Timer* t = _first;
+  while (t) {
+    if (t->isRunning()) {
+      micros_t due = t->_microsTime ? t->_microsTime : now + t->remainingMicros();
+      if (soonest == 0 || due < soonest) {
+        soonest = due;
+      }
+    }
+    t = t->_next;
+  }
+  return soonest;
 }
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <time.h>
+
+#if !defined(TIMER_SPIN_MICROS)
+#define TIMER_SPIN_MICROS 100  // sleeping is only this accurate, so spin for the last part of the wait
+#endif
+
+void Timer::wait(micros_t maxWait) {
+  micros_t now = Uptime::micros();
+  micros_t until = now + maxWait;
+  micros_t next = nextDeadline();
+  if (next && next < until) {
+    until = next;
+  }
+
+  // simulated time only moves when asked to
+  if (Uptime::getSource() == nullptr) {
+    micros_t sleep = until - now - TIMER_SPIN_MICROS;
+    if (sleep > 0) {
+      struct timespec ts;
+      ts.tv_sec = sleep / Time::microsPerSec;
+      ts.tv_nsec = (sleep % Time::microsPerSec) * 1000;
+      nanosleep(&ts, nullptr);
+    }
+    while (Uptime::micros() < until) {
+    }
+  }
+  idle();
+}
+#endif
+
 void Timer::insert() {
    //console.debugf("Inserting timer %d\n",this);
 
@@ -162,11 +271,16 @@ void Timer::insert() {
   _next = _first;
   _prev = nullptr;
   _first = this;
+
+  if (_changeHook) {
+    _changeHook(this, true);
+  }
 }
 
 void Timer::remove() {
   //console.debugf("removing timer %d\n",this);
 
+  bool listed = _prev || _first == this;
   if (_next) {
     _next->_prev = _prev;
   }
@@ -181,6 +295,10 @@ void Timer::remove() {
 
   _next = nullptr;
   _prev = nullptr;
+
+  if (listed && _changeHook) {
+    _changeHook(this, false);
+  }
 }
 
 void Timer::printInfo(Print* p) {
@@ -190,7 +308,7 @@ void Timer::printInfo(Print* p) {
     i++;
     pprintf(p, " Timer: %d :\n",(int)t);
     pprintf(p, "  Remaining: %d\n", (int)t->remainingMillis());
-    pprintf(p, "  Millis: %d\n", (int)t->_millisTime);
+    pprintf(p, "  Millis: %d\n", (int)(t->_microsTime/Time::microsPerMilli));
     pprintf(p, "  Clocktime: %d\n", (int)t->_clockTime);
     p->println(t->_repeatTimer ? "  Repeating" : "  Not repeating");
     p->println(t->isPaused() ? "  Paused" : "  Not paused");
@@ -218,4 +336,10 @@ void CallbackTimer::setMillis(millis_t millisDuration, timerCallback_t callback,
   Timer::setMillis(millisDuration,repeat);
 }
 
+void CallbackTimer::setMicros(micros_t microsDuration, timerCallback_t callback, void* callbackData, bool repeat) {
+  _cb = callback;
+  setData(callbackData);
+  Timer::setMicros(microsDuration,repeat);
+}
+
 
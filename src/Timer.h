@@ -3,6 +3,19 @@
 
 #include "Arduino.h"
 #include "Clock.h"
+#include "Histogram.h"
+
+// what a repeating timer does when idle() was called too late to fire it on time
+enum timerCatchUp_t {
+  timerFireAll,      // fire once for every missed period, back to back (the default)
+  timerSkipMissed,   // fire once, then the next period starts now
+  timerRealign       // fire once, then skip to the next deadline in the original phase
+};
+
+class Timer;
+typedef void (*timerCallback_t)(void*);
+typedef void (*timerChangeHook_t)(Timer* timer, bool armed);
+typedef void (*timerFireHook_t)(Timer* timer);
 
 class Timer {
   public:
@@ -10,16 +23,23 @@ class Timer {
 
     void setSecs(time_t setTime, bool repeat = false);
     void setMillis(millis_t millisDur, bool repeat = false);
+    void setMicros(micros_t microsDur, bool repeat = false);
     void setClockTime(time_t clockTimeSet);
 
     time_t remainingSecs();  // seconds from now (works on both kinds of timer)
     millis_t remainingMillis();  // millis from now (works on both kinds of timer)
+    micros_t remainingMicros();  // micros from now (works on both kinds of timer)
 
     time_t timeInSecs();   // clock time of timer (works on both kinds of timer)
     millis_t timeInMillis();   // millis() time of timer (works on both kinds of timer)
+    micros_t timeInMicros();   // Uptime::micros() time of timer (works on both kinds of timer)
 
     time_t durationSecs();  // how far out was the timer when it was initially set?
     millis_t durationMillis();
+    micros_t durationMicros();
+
+    void setCatchUp(timerCatchUp_t catchUp) { _catchUp = catchUp; }
+    timerCatchUp_t getCatchUp() { return _catchUp; }
 
     void cancel();         // cancel timer including callback
 
@@ -28,15 +48,28 @@ class Timer {
     bool isPaused();       // is paused
     bool isRunning();        // is the timer running?  (i.e. is not paused and is set)
     bool hasPassed();         // is the timer in the past
-    bool isReset() { return ((_millisTime == 0) && (_clockTime == 0)); }
+    bool isReset() { return ((_microsTime == 0) && (_clockTime == 0)); }
     void setData(void* data) { _data = data; }
     void* getData() { return _data; };
+    void setId(uint32_t id) { _id = id; }  // non-zero ids are saved by TimerSnapshot
+    uint32_t getId() { return _id; }
 
     static void idle();    // idle so callbacks get a chance to run
+    static micros_t nextDeadline();  // Uptime::micros() when the soonest running timer is due, 0 if none
+    static void setIdleHook(void (*hook)()) { _idleHook = hook; }  // called at the end of each idle(), once no timer list walk is in progress
+    static void setJitter(Histogram* jitter) { _jitter = jitter; }  // collects how late each timer fires, in micros
+    static void setFireHook(timerFireHook_t hook) { _fireHook = hook; }  // called by idle() just before each timer's callback
+    static void setChangeHook(timerChangeHook_t hook) { _changeHook = hook; }  // called after a timer is inserted, resumed (armed is true), removed or paused (armed is false)
+#if defined(__unix__) || defined(__APPLE__)
+    static void wait(micros_t maxWait = Time::microsPerSec);  // sleep, then spin, until the next timer is due, then idle()
+#endif
     static Timer* first() { return _first; }
     Timer* next() { return _next; }
     static void printInfo(Print* p);
   protected:
+    friend class TimerSnapshot;
+    bool hasPassed(micros_t now);
+    void rearm(micros_t now);
     void insert();
     void remove();
     virtual void callback() = 0;
@@ -46,23 +79,29 @@ class Timer {
 
     time_t _clockTime = 0;
 
-    millis_t _millisTime = 0;
-    millis_t _millisDur = 0;
+    micros_t _microsTime = 0;
+    micros_t _microsDur = 0;
     bool _repeatTimer;
+    timerCatchUp_t _catchUp = timerFireAll;
     void* _data = nullptr;
+    uint32_t _id = 0;
 
     static Timer* _first;
+    static void (*_idleHook)();
+    static Histogram* _jitter;
+    static timerChangeHook_t _changeHook;
+    static timerFireHook_t _fireHook;
 
 };
 
-typedef void (*timerCallback_t)(void*);
-
 class CallbackTimer : public Timer {
 
   public:
     void setSecs(time_t setTime, timerCallback_t callback, void* callbackData, bool repeat = false);
     void setMillis(millis_t millisDur, timerCallback_t callback, void* callbackData, bool repeat = false);
+    void setMicros(micros_t microsDur, timerCallback_t callback, void* callbackData, bool repeat = false);
     void setClockTime(time_t clockTimeSet, timerCallback_t callback, void* callbackData);
+    void setCallback(timerCallback_t callback, void* callbackData) { _cb = callback; setData(callbackData); }  // without arming
 
   protected:
     virtual void callback() { if (_cb) { (_cb)(_data); }; }
@@ -0,0 +1,84 @@
+#include "TimerFd.h"
+
+#if defined(TIMERFD)
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+int TimerFd::_fd = -1;
+micros_t TimerFd::_armed = 0;
+bool TimerFd::_dispatching = false;
+
+int TimerFd::begin() {
+  if (_fd >= 0) {
+    return _fd;
+  }
+  _fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (_fd < 0) {
+    return -1;
+  }
+  _armed = 0;
+  Timer::setChangeHook(&changed);
+  arm(Timer::nextDeadline());
+  return _fd;
+}
+
+void TimerFd::end() {
+  if (_fd < 0) {
+    return;
+  }
+  Timer::setChangeHook(nullptr);
+  close(_fd);
+  _fd = -1;
+  _armed = 0;
+}
+
+void TimerFd::handle() {
+  uint64_t expirations;
+  while (read(_fd, &expirations, sizeof(expirations)) > 0) {
+  }
+
+  // callbacks set and cancel timers, just re-arm once when they are all done
+  _dispatching = true;
+  Timer::idle();
+  _dispatching = false;
+
+  _armed = 0;
+  arm(Timer::nextDeadline());
+}
+
+// a new deadline only needs a re-arm if it's sooner, an old one only if it was the one armed
+void TimerFd::changed(Timer* timer, bool armed) {
+  if (_dispatching) {
+    return;
+  }
+  if (armed) {
+    if (timer->isRunning()) {
+      micros_t due = timer->timeInMicros();
+      if (_armed == 0 || due < _armed) {
+        arm(due);
+      }
+    }
+  } else if (_armed && timer->timeInMicros() <= _armed) {
+    arm(Timer::nextDeadline());
+  }
+}
+
+void TimerFd::arm(micros_t deadline) {
+  struct itimerspec spec = {};
+  if (deadline) {
+    // timerfd uses CLOCK_MONOTONIC, not Uptime, so go by how long from now.  Zero would disarm it, so at least 1ns
+    micros_t wait = deadline - Uptime::micros();
+    if (wait > 0) {
+      spec.it_value.tv_sec = wait / Time::microsPerSec;
+      spec.it_value.tv_nsec = (wait % Time::microsPerSec) * 1000;
+    } else {
+      spec.it_value.tv_nsec = 1;
+    }
+  }
+  if (timerfd_settime(_fd, 0, &spec, nullptr) == 0) {
+    _armed = deadline;
+  }
+}
+
+#endif // TIMERFD
@@ -0,0 +1,40 @@
+#ifndef _TimerFd_
+#define _TimerFd_
+
+#include "Timer.h"
+
+// TimerFd lets the timers run from an existing epoll (or poll/select) loop on Linux instead of calling Timer::idle():
+//
+//   int fd = TimerFd::begin();
+//   epoll_event ev = { EPOLLIN };
+//   ev.data.fd = fd;
+//   epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+//   ...
+//   if (events[i].data.fd == fd) { TimerFd::handle(); }
+//
+// All the timers share one timerfd, which is kept armed for the soonest deadline as timers are set, cancelled,
+// paused and resumed.  When it becomes readable, handle() runs the timers that are due and re-arms it.
+
+#if defined(__linux__)
+#define TIMERFD
+
+class TimerFd {
+  public:
+    static int begin();   // returns the file descriptor to wait on, -1 on error
+    static void end();
+    static int fd() { return _fd; }
+
+    static void handle();  // call when fd() is readable
+
+  private:
+    static void changed(Timer* timer, bool armed);
+    static void arm(micros_t deadline);
+
+    static int _fd;
+    static micros_t _armed;  // Uptime::micros() deadline the timerfd is set for, 0 if disarmed
+    static bool _dispatching;
+};
+
+#endif
+
+#endif
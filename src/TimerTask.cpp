@@ -0,0 +1,117 @@
+#include "TimerTask.h"
+
+#if defined(TIMERTASK_COROUTINES)
+
+#include <new>
+
+union TimerTaskFrame {
+  TimerTaskFrame* next;
+  alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) uint8_t bytes[TIMERTASK_FRAME_SIZE];
+};
+
+static TimerTaskFrame framePool[TIMERTASK_FRAME_COUNT];
+static TimerTaskFrame* freeFrames = nullptr;
+static uint16_t usedFrames = 0;  // frames that have never been handed out start after this
+
+uint32_t TimerTaskPool::_heapFrames = 0;
+uint32_t TimerTaskPool::_failedFrames = 0;
+
+void* TimerTaskPool::allocate(size_t size) {
+  if (size <= sizeof(TimerTaskFrame)) {
+    if (freeFrames) {
+      TimerTaskFrame* f = freeFrames;
+      freeFrames = f->next;
+      return f;
+    }
+    if (usedFrames < TIMERTASK_FRAME_COUNT) {
+      return &framePool[usedFrames++];
+    }
+  }
+#if defined(TIMERTASK_POOL_ONLY)
+  _failedFrames++;
+  return nullptr;
+#else
+  _heapFrames++;
+  return ::operator new(size);
+#endif
+}
+
+void TimerTaskPool::release(void* frame, size_t size) {
+  TimerTaskFrame* f = (TimerTaskFrame*)frame;
+  if (f >= framePool && f < framePool + TIMERTASK_FRAME_COUNT) {
+    f->next = freeFrames;
+    freeFrames = f;
+  } else {
+    ::operator delete(frame, size);
+  }
+}
+
+uint16_t TimerTaskPool::available() {
+  uint16_t n = TIMERTASK_FRAME_COUNT - usedFrames;
+  for (TimerTaskFrame* f = freeFrames; f; f = f->next) {
+    n++;
+  }
+  return n;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+ResumeTimer* ResumeTimer::_firstReady = nullptr;
+ResumeTimer* ResumeTimer::_lastReady = nullptr;
+
+ResumeTimer::~ResumeTimer() {
+  unready();
+}
+
+// resuming from inside Timer::idle() could destroy timers it is about to look at, so just queue it up
+void ResumeTimer::callback() {
+  if (_ready) {
+    return;
+  }
+  _ready = true;
+  _nextReady = nullptr;
+  if (_lastReady) {
+    _lastReady->_nextReady = this;
+  } else {
+    _firstReady = this;
+  }
+  _lastReady = this;
+  Timer::setIdleHook(&runReady);
+}
+
+void ResumeTimer::unready() {
+  if (!_ready) {
+    return;
+  }
+  ResumeTimer* prev = nullptr;
+  for (ResumeTimer* r = _firstReady; r; prev = r, r = r->_nextReady) {
+    if (r == this) {
+      if (prev) {
+        prev->_nextReady = _nextReady;
+      } else {
+        _firstReady = _nextReady;
+      }
+      if (_lastReady == this) {
+        _lastReady = prev;
+      }
+      break;
+    }
+  }
+  _nextReady = nullptr;
+  _ready = false;
+}
+
+void ResumeTimer::runReady() {
+  // the resumed coroutine usually destroys its timer, so take it off the queue first
+  while (_firstReady) {
+    ResumeTimer* r = _firstReady;
+    _firstReady = r->_nextReady;
+    if (!_firstReady) {
+      _lastReady = nullptr;
+    }
+    r->_nextReady = nullptr;
+    r->_ready = false;
+    r->resume();
+  }
+}
+
+#endif // TIMERTASK_COROUTINES
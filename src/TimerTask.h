@@ -0,0 +1,254 @@
+#ifndef _TimerTask_
+#define _TimerTask_
+
+#include "Timer.h"
+
+// C++20 coroutines on top of Timer:
+//
+//   TimerTask<> blink() {
+//     while (true) {
+//       toggleLed();
+//       co_await sleepFor(500);
+//     }
+//   }
+//   ...
+//   spawn(blink());   // then keep calling Timer::idle() as usual
+//
+// Sleeping coroutines are ordinary timers, and are resumed by Timer::idle() after it has walked the timer list.
+// Coroutine frames come from a fixed pool (see TIMERTASK_FRAME_SIZE and TIMERTASK_FRAME_COUNT) and nothing allocates on resume.
+// Frames that don't fit the pool go to the heap and are counted in TimerTaskPool::heapFrames(), or, if TIMERTASK_POOL_ONLY
+// is defined, fail: the coroutine returns an invalid TimerTask (see TimerTask::isValid()).
+
+#if defined(__has_include)
+#if __has_include(<coroutine>) && defined(__cpp_impl_coroutine)
+#define TIMERTASK_COROUTINES
+#endif
+#endif
+
+#if defined(TIMERTASK_COROUTINES)
+
+#include <coroutine>
+#include <exception>
+
+#if !defined(TIMERTASK_FRAME_SIZE)
+#define TIMERTASK_FRAME_SIZE 256
+#endif
+
+#if !defined(TIMERTASK_FRAME_COUNT)
+#define TIMERTASK_FRAME_COUNT 32
+#endif
+
+// fixed size blocks for coroutine frames, falls back to the heap for frames that are too big or when the pool is empty
+class TimerTaskPool {
+  public:
+    static void* allocate(size_t size);  // nullptr instead of the heap if TIMERTASK_POOL_ONLY is defined
+    static void release(void* frame, size_t size);
+    static uint16_t available();
+    static uint32_t heapFrames() { return _heapFrames; }  // frames that could not come from the pool
+    static uint32_t failedFrames() { return _failedFrames; }  // frames that could not be allocated at all
+
+  private:
+    static uint32_t _heapFrames;
+    static uint32_t _failedFrames;
+};
+
+// a Timer that resumes a coroutine when it fires
+class ResumeTimer : public Timer {
+  public:
+    ~ResumeTimer();
+    void setHandle(std::coroutine_handle<> handle) { _handle = handle; }
+    static void runReady();  // resume the coroutines whose timers have fired
+
+  protected:
+    virtual void callback();
+    virtual void resume() { _handle.resume(); }
+    void unready();
+
+    std::coroutine_handle<> _handle;
+    ResumeTimer* _nextReady = nullptr;
+    bool _ready = false;
+
+    static ResumeTimer* _firstReady;
+    static ResumeTimer* _lastReady;
+};
+
+class TimerTaskPromiseBase {
+  public:
+#if defined(TIMERTASK_POOL_ONLY)
+    static void* operator new(size_t size) noexcept { return TimerTaskPool::allocate(size); }
+#else
+    static void* operator new(size_t size) { return TimerTaskPool::allocate(size); }
+#endif
+    static void operator delete(void* frame, size_t size) { TimerTaskPool::release(frame, size); }
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    struct FinalAwaiter {
+      bool await_ready() noexcept { return false; }
+      template <class P>
+      std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept {
+        TimerTaskPromiseBase& p = h.promise();
+        if (p._continuation) {
+          return p._continuation;
+        }
+        if (p._detached) {
+          h.destroy();
+        }
+        return std::noop_coroutine();
+      }
+      void await_resume() noexcept {}
+    };
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { std::terminate(); }
+
+    std::coroutine_handle<> _continuation;
+    bool _detached = false;
+};
+
+template <class T>
+class TimerTaskPromise : public TimerTaskPromiseBase {
+  public:
+    void return_value(T value) { _value = static_cast<T&&>(value); }
+    T& result() { return _value; }
+  private:
+    T _value{};
+};
+
+template <>
+class TimerTaskPromise<void> : public TimerTaskPromiseBase {
+  public:
+    void return_void() {}
+    void result() {}
+};
+
+// a lazily started coroutine, either co_await it from another TimerTask or spawn() it
+template <class T = void>
+class TimerTask {
+  public:
+    class promise_type : public TimerTaskPromise<T> {
+      public:
+        TimerTask get_return_object() { return TimerTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+#if defined(TIMERTASK_POOL_ONLY)
+        static TimerTask get_return_object_on_allocation_failure() { return TimerTask(); }
+#endif
+    };
+    typedef std::coroutine_handle<promise_type> handle_t;
+
+    TimerTask() {}
+    TimerTask(TimerTask&& t) : _handle(t._handle) { t._handle = nullptr; }
+    TimerTask& operator=(TimerTask&& t) { if (this != &t) { cancel(); _handle = t._handle; t._handle = nullptr; } return *this; }
+    TimerTask(const TimerTask&) = delete;
+    TimerTask& operator=(const TimerTask&) = delete;
+    ~TimerTask() { cancel(); }
+
+    bool isValid() { return (bool)_handle; }
+    bool isDone() { return !_handle || _handle.done(); }
+    decltype(auto) result() { return _handle.promise().result(); }  // only for a valid task
+
+    void cancel() {  // destroys the coroutine, including any pending sleeps
+      if (_handle) {
+        _handle.destroy();
+        _handle = nullptr;
+      }
+    }
+
+    void start() {  // run detached, the frame is freed when the coroutine finishes
+      handle_t h = _handle;
+      _handle = nullptr;
+      if (h) {
+        h.promise()._detached = true;
+        h.resume();
+      }
+    }
+
+    handle_t handle() { return _handle; }
+
+    struct Awaiter {
+      handle_t _task;
+      bool await_ready() { return !_task || _task.done(); }
+      std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) {
+        _task.promise()._continuation = awaiting;
+        return _task;
+      }
+      // a task that failed to allocate its frame (see TIMERTASK_POOL_ONLY) is never run, and gives T()
+      T await_resume() {
+        if (!_task) {
+          return T();
+        }
+        return _task.promise().result();
+      }
+    };
+    Awaiter operator co_await() { return Awaiter{_handle}; }
+
+  private:
+    explicit TimerTask(handle_t h) : _handle(h) {}
+    handle_t _handle;
+};
+
+template <class T>
+void spawn(TimerTask<T>&& task) { task.start(); }
+
+// co_await sleepFor(millis)
+class SleepAwaiter : public ResumeTimer {
+  public:
+    SleepAwaiter(millis_t millisDur) : _millisDur(millisDur) {}
+    bool await_ready() { return _millisDur <= 0; }
+    void await_suspend(std::coroutine_handle<> h) { setHandle(h); setMillis(_millisDur); }
+    void await_resume() {}
+  private:
+    millis_t _millisDur;
+};
+
+// co_await sleepUntil(clockTime)
+class SleepUntilAwaiter : public ResumeTimer {
+  public:
+    SleepUntilAwaiter(time_t clockTime) : _clockTime(clockTime) {}
+    bool await_ready() { return false; }
+    void await_suspend(std::coroutine_handle<> h) { setHandle(h); setClockTime(_clockTime); }
+    void await_resume() {}
+  private:
+    time_t _clockTime;
+};
+
+inline SleepAwaiter sleepFor(millis_t millisDur) { return SleepAwaiter(millisDur); }
+inline SleepUntilAwaiter sleepUntil(time_t clockTime) { return SleepUntilAwaiter(clockTime); }
+
+// bool finished = co_await withTimeout(task, millis)
+// runs the task, and if it has not finished after millis, cancels it.  The result of a finished task is in task.result().
+template <class T>
+class TimeoutAwaiter : public ResumeTimer {
+  public:
+    TimeoutAwaiter(TimerTask<T>& task, millis_t millisDur) : _task(task), _millisDur(millisDur) {}
+    bool await_ready() { return _task.isDone(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> h) {
+      setHandle(h);
+      setMillis(_millisDur);
+      _task.handle().promise()._continuation = h;
+      return _task.handle();
+    }
+    bool await_resume() {
+      if (_timedOut) {
+        return false;
+      }
+      cancel();
+      unready();
+      return _task.isValid();
+    }
+  protected:
+    virtual void resume() {
+      _timedOut = true;
+      _task.cancel();
+      _handle.resume();
+    }
+  private:
+    TimerTask<T>& _task;
+    millis_t _millisDur;
+    bool _timedOut = false;
+};
+
+template <class T>
+TimeoutAwaiter<T> withTimeout(TimerTask<T>& task, millis_t millisDur) { return TimeoutAwaiter<T>(task, millisDur); }
+
+#endif // TIMERTASK_COROUTINES
+
+#endif
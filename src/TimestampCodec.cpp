@@ -0,0 +1,307 @@
+#include "TimestampCodec.h"
+#include "TimePoint.h"
+#include <string.h>
+
+// deltas are taken modulo 2^64, so widely spaced values wrap around instead of overflowing, and decode back the same
+static inline uint64_t zigzag(uint64_t v) { return (v << 1) ^ ((uint64_t)0 - (v >> 63)); }
+static inline uint64_t unzigzag(uint64_t v) { return (v >> 1) ^ ((uint64_t)0 - (v & 1)); }
+static inline uint64_t diff(micros_t a, micros_t b) { return (uint64_t)a - (uint64_t)b; }
+
+static inline uint8_t bitWidth(uint64_t v) {
+  uint8_t w = 0;
+  while (v) { w++; v >>= 1; }
+  return w;
+}
+
+static size_t putVarint(uint8_t* b, uint64_t v) {
+  size_t n = 0;
+  while (v >= 0x80) {
+    b[n++] = (uint8_t)v | 0x80;
+    v >>= 7;
+  }
+  b[n++] = (uint8_t)v;
+  return n;
+}
+
+static size_t getVarint(const uint8_t* b, size_t len, uint64_t* v) {
+  uint64_t result = 0;
+  for (size_t n = 0; n < len && n < 10; n++) {
+    result |= (uint64_t)(b[n] & 0x7f) << (7*n);
+    if (!(b[n] & 0x80)) {
+      *v = result;
+      return n + 1;
+    }
+  }
+  return 0;
+}
+
+// bits [bit, bit+w) of a little endian bit stream, for any w up to 64
+static uint64_t getBits(const uint8_t* b, size_t bit, uint8_t w) {
+  uint64_t v = 0;
+  uint8_t got = 0;
+  while (got < w) {
+    uint8_t shift = bit & 7;
+    uint8_t take = 8 - shift;
+    if (take > w - got) { take = w - got; }
+    v |= (uint64_t)((b[bit >> 3] >> shift) & ((1u << take) - 1)) << got;
+    got += take;
+    bit += take;
+  }
+  return v;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TimestampEncoder::TimestampEncoder(uint8_t* buffer, size_t len, uint32_t* blockOffsets, uint32_t maxBlocks) {
+  _buffer = buffer;
+  _len = len;
+  _offsets = blockOffsets;
+  _maxOffsets = maxBlocks;
+}
+
+bool TimestampEncoder::append(micros_t t) {
+  if (_pendingCount == TIMESTAMPCODEC_BLOCK && !flush()) {
+    return false;
+  }
+  _pending[_pendingCount++] = t;
+  _count++;
+  return true;
+}
+
+bool TimestampEncoder::flush() {
+  uint16_t n = _pendingCount;
+  if (n == 0) {
+    return true;
+  }
+  if (_offsets && _blocks >= _maxOffsets) {
+    return false;
+  }
+
+  // size the block before packing anything, so a full buffer leaves the pending values intact for a retry
+  uint64_t all = 0;
+  uint64_t lastDelta = n > 1 ? diff(_pending[1], _pending[0]) : 0;
+  for (uint16_t i = 2; i < n; i++) {
+    uint64_t delta = diff(_pending[i], _pending[i - 1]);
+    all |= zigzag(delta - lastDelta);
+    lastDelta = delta;
+  }
+  uint8_t w = bitWidth(all);
+
+  uint8_t header[2 + 10 + 10];
+  size_t h = 0;
+  header[h++] = n;
+  header[h++] = w;
+  h += putVarint(header + h, zigzag((uint64_t)_pending[0]));
+  if (n > 1) {
+    h += putVarint(header + h, zigzag(diff(_pending[1], _pending[0])));
+  }
+  size_t packed = n > 2 ? ((size_t)(n - 2) * w + 7) / 8 : 0;
+  if (_size + h + packed > _len) {
+    return false;
+  }
+
+  uint8_t* b = _buffer + _size;
+  memcpy(b, header, h);
+  b += h;
+  memset(b, 0, packed);
+  size_t bit = 0;
+  lastDelta = n > 1 ? diff(_pending[1], _pending[0]) : 0;
+  for (uint16_t i = 2; i < n; i++) {
+    uint64_t delta = diff(_pending[i], _pending[i - 1]);
+    uint64_t v = zigzag(delta - lastDelta);
+    lastDelta = delta;
+    for (uint8_t left = w; left; ) {
+      uint8_t shift = bit & 7;
+      uint8_t put = 8 - shift;
+      if (put > left) { put = left; }
+      b[bit >> 3] |= (uint8_t)((v & ((1u << put) - 1)) << shift);
+      v >>= put;
+      bit += put;
+      left -= put;
+    }
+  }
+
+  if (_offsets) {
+    _offsets[_blocks] = _size;
+  }
+  _blocks++;
+  _size += h + packed;
+  _pendingCount = 0;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TimestampDecoder::TimestampDecoder(const uint8_t* buffer, size_t len, const uint32_t* blockOffsets, uint32_t blocks) {
+  _buffer = buffer;
+  _len = len;
+  _offsets = blockOffsets;
+  _offsetCount = blocks;
+}
+
+bool TimestampDecoder::readHeader(size_t pos) {
+  if (pos + 2 > _len) {
+    return false;
+  }
+  const uint8_t* b = _buffer + pos;
+  size_t left = _len - pos;
+  uint16_t n = b[0];
+  uint8_t w = b[1];
+  // blocks may be bigger than our TIMESTAMPCODEC_BLOCK, they're returned in pieces
+  if (n == 0 || w > 64) {
+    return false;
+  }
+  size_t h = 2;
+  uint64_t first = 0;
+  uint64_t firstDelta = 0;
+  size_t got = getVarint(b + h, left - h, &first);
+  if (!got) { return false; }
+  h += got;
+  if (n > 1) {
+    got = getVarint(b + h, left - h, &firstDelta);
+    if (!got) { return false; }
+    h += got;
+  }
+  size_t packed = n > 2 ? ((size_t)(n - 2) * w + 7) / 8 : 0;
+  if (h + packed > left) {
+    return false;
+  }
+  _blockCount = n;
+  _width = w;
+  _first = unzigzag(first);
+  _firstDelta = unzigzag(firstDelta);
+  _packedPos = pos + h;
+  _blockLen = h + packed;
+  return true;
+}
+
+void TimestampDecoder::unpack(micros_t* out, uint16_t count) {
+  uint16_t start = _blockCount - _left;  // index in the block of out[0]
+  uint16_t o = 0;
+  if (start == 0) {
+    _value = _first;
+    out[o++] = (micros_t)_value;
+  }
+  if (start + o == 1 && o < count) {
+    _delta = _firstDelta;
+    _value += _delta;
+    out[o++] = (micros_t)_value;
+  }
+  if (o == count) {
+    return;
+  }
+
+  // the zigzag delta-of-deltas of the rest are bit packed, from the block's third value on
+  const uint8_t* p = _buffer + _packedPos;
+  size_t firstPacked = start + o - 2;
+  uint8_t w = _width;
+  uint64_t* dods = (uint64_t*)out;
+  uint16_t i = o;
+  if (w == 0) {
+    for (; i < count; i++) { dods[i] = 0; }
+  } else {
+    // branch free unpacking with one unaligned 64 bit load per value and a fixed trip count, so compilers can vectorize it,
+    // then byte at a time for wide values, big endian hosts and the values too near the end of the buffer to load 8 bytes
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    size_t avail = _len - _packedPos;  // bytes we may load from, the packed bits and whatever follows them
+    if (w <= 56 && avail >= 8) {
+      // packed value j can be loaded whole while (j * w) / 8 + 8 <= avail
+      size_t loadable = ((avail - 7) * 8 - 1) / w + 1;
+      uint16_t fastEnd = o;
+      if (loadable > firstPacked) {
+        fastEnd = loadable - firstPacked < (size_t)(count - o) ? (uint16_t)(o + loadable - firstPacked) : count;
+      }
+      uint64_t mask = ((uint64_t)1 << w) - 1;
+      for (; i < fastEnd; i++) {
+        size_t bit = (firstPacked + i - o) * w;
+        uint64_t word;
+        memcpy(&word, p + (bit >> 3), 8);
+        dods[i] = (word >> (bit & 7)) & mask;
+      }
+    }
+#endif
+    for (; i < count; i++) {
+      dods[i] = getBits(p, (firstPacked + i - o) * w, w);
+    }
+  }
+
+  for (i = o; i < count; i++) {
+    _delta += unzigzag(dods[i]);
+    _value += _delta;
+    out[i] = (micros_t)_value;
+  }
+}
+
+bool TimestampDecoder::seek(uint32_t block) {
+  _left = 0;
+  if (_offsets && block < _offsetCount) {
+    _pos = _offsets[block];
+    _block = block;
+    return true;
+  }
+  // walk the block headers, from where we are if that's on the way
+  if (block < _block) {
+    rewind();
+  }
+  while (_block < block) {
+    if (!readHeader(_pos)) {
+      return false;
+    }
+    _pos += _blockLen;
+    _block++;
+  }
+  return true;
+}
+
+uint16_t TimestampDecoder::next(micros_t* out) {
+  if (_left == 0) {
+    if (!readHeader(_pos)) {
+      return 0;
+    }
+    _left = _blockCount;
+  }
+  uint16_t n = _left < TIMESTAMPCODEC_BLOCK ? _left : TIMESTAMPCODEC_BLOCK;
+  unpack(out, n);
+  _left -= n;
+  if (_left == 0) {
+    _pos += _blockLen;
+    _block++;
+  }
+  return n;
+}
+
+uint16_t TimestampDecoder::decodeBlock(uint32_t block, micros_t* out) {
+  return seek(block) ? next(out) : 0;
+}
+
+uint16_t TimestampDecoder::nextFields(TimestampFields& fields) {
+  return toFields(next(_scratch), _scratch, fields);
+}
+
+uint16_t TimestampDecoder::decodeFields(uint32_t block, TimestampFields& fields) {
+  return toFields(decodeBlock(block, _scratch), _scratch, fields);
+}
+
+uint16_t TimestampDecoder::toFields(uint16_t n, micros_t* values, TimestampFields& fields) {
+  // consecutive timestamps are usually on the same day, so only do the date math when the day changes
+  int32_t lastDays = 0;
+  uint16_t y = 0;
+  uint8_t m = 0, d = 0, wd = 0;
+  for (uint16_t i = 0; i < n; i++) {
+    TimePoint t(values[i]);
+    int32_t days = t.days();
+    if (i == 0 || days != lastDays) {
+      lastDays = days;
+      TimePoint::civilFromDays(days, y, m, d);
+      wd = TimePoint::weekdayFromDays(days);
+    }
+    uint32_t s = t.secondOfDay();
+    if (fields.year) { fields.year[i] = y; }
+    if (fields.month) { fields.month[i] = m; }
+    if (fields.day) { fields.day[i] = d; }
+    if (fields.weekday) { fields.weekday[i] = wd; }
+    if (fields.hour) { fields.hour[i] = s / Time::secsPerHour; }
+    if (fields.minute) { fields.minute[i] = s % Time::secsPerHour / Time::secsPerMin; }
+    if (fields.second) { fields.second[i] = s % Time::secsPerMin; }
+    if (fields.fracMicros) { fields.fracMicros[i] = t.fracMicros(); }
+  }
+  return n;
+}
@@ -0,0 +1,103 @@
+#ifndef _TimestampCodec_
+#define _TimestampCodec_
+
+#include "Clock.h"
+
+// Compact encoding for series of micros_t timestamps that are sorted or nearly so, as from Uptime or Clock.
+//
+// Timestamps are grouped in blocks of up to TIMESTAMPCODEC_BLOCK values (at most 255).  Each block stands on its own:
+//   count (1 byte), bit width (1 byte), first value (zigzag varint), first delta (zigzag varint, if count > 1),
+//   then the zigzag encoded delta-of-deltas of the remaining values, bit packed at the block's bit width.
+// Periodic series have delta-of-deltas of zero and pack to a few bytes per block.
+//
+// The decoder reads blocks of any size, and returns those bigger than its own TIMESTAMPCODEC_BLOCK over several calls,
+// so data encoded with big blocks on a host can be decoded on a microcontroller.
+
+#if !defined(TIMESTAMPCODEC_BLOCK)
+#if defined(CLOCK_THREADS)
+#define TIMESTAMPCODEC_BLOCK 128  // values per block, at most 255
+#else
+#define TIMESTAMPCODEC_BLOCK 32
+#endif
+#endif
+
+static_assert(TIMESTAMPCODEC_BLOCK > 0 && TIMESTAMPCODEC_BLOCK <= 255, "TIMESTAMPCODEC_BLOCK must be 1 to 255");
+
+// column arrays for TimestampDecoder::decodeFields(), each must hold a full block.  Leave a column nullptr to skip it.
+struct TimestampFields {
+  uint16_t* year = nullptr;
+  uint8_t* month = nullptr;
+  uint8_t* day = nullptr;
+  uint8_t* weekday = nullptr;
+  uint8_t* hour = nullptr;
+  uint8_t* minute = nullptr;
+  uint8_t* second = nullptr;
+  uint32_t* fracMicros = nullptr;
+};
+
+class TimestampEncoder {
+  public:
+    // blockOffsets, if given, receives the byte offset of each block, for random access when decoding
+    TimestampEncoder(uint8_t* buffer, size_t len, uint32_t* blockOffsets = nullptr, uint32_t maxBlocks = 0);
+
+    bool append(micros_t t);   // false if the buffer (or the offsets table) is full
+    bool flush();              // write out a partial block, call before using the encoded data
+
+    size_t size() { return _size; }          // bytes of encoded data
+    uint32_t blocks() { return _blocks; }
+    uint32_t count() { return _count; }      // timestamps appended, including those not yet flushed
+
+  private:
+    uint8_t* _buffer;
+    size_t _len;
+    size_t _size = 0;
+    uint32_t* _offsets;
+    uint32_t _maxOffsets;
+    uint32_t _blocks = 0;
+    uint32_t _count = 0;
+
+    micros_t _pending[TIMESTAMPCODEC_BLOCK];
+    uint16_t _pendingCount = 0;
+};
+
+class TimestampDecoder {
+  public:
+    TimestampDecoder(const uint8_t* buffer, size_t len, const uint32_t* blockOffsets = nullptr, uint32_t blocks = 0);
+
+    // the following return the count of timestamps decoded into out (which must hold TIMESTAMPCODEC_BLOCK values), 0 at the end or on bad data.
+    // a block of more than TIMESTAMPCODEC_BLOCK values is returned in pieces, by the following calls to next()
+    uint16_t next(micros_t* out);                     // the next block, or the rest of the current one
+    uint16_t decodeBlock(uint32_t block, micros_t* out);  // any block, fast if the block offsets were given
+    uint16_t nextFields(TimestampFields& fields);     // the next block, as calendar fields
+    uint16_t decodeFields(uint32_t block, TimestampFields& fields);
+
+    bool seek(uint32_t block);  // the next call to next() decodes this block, only reads the block headers on the way
+    void rewind() { _pos = 0; _block = 0; _left = 0; }
+
+  private:
+    bool readHeader(size_t pos);  // sets up the block at pos, false on bad data
+    void unpack(micros_t* out, uint16_t count);
+    uint16_t toFields(uint16_t n, micros_t* values, TimestampFields& fields);
+
+    const uint8_t* _buffer;
+    size_t _len;
+    const uint32_t* _offsets;
+    uint32_t _offsetCount;
+    size_t _pos = 0;  // of the block being decoded
+    uint32_t _block = 0;
+
+    // the block being decoded
+    size_t _packedPos = 0;
+    size_t _blockLen = 0;
+    uint16_t _blockCount = 0;
+    uint16_t _left = 0;  // values not yet returned
+    uint8_t _width = 0;
+    uint64_t _first = 0;
+    uint64_t _firstDelta = 0;
+    uint64_t _value = 0;  // the last value returned, and the delta to it
+    uint64_t _delta = 0;
+
+    micros_t _scratch[TIMESTAMPCODEC_BLOCK];
+};
+
+#endif
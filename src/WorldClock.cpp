@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <string.h>
+#include "WorldClock.h"
+#include "TimePoint.h"
+
+#if !defined(WORLDCLOCK_MAX_ZONES)
+#define WORLDCLOCK_MAX_ZONES 32  // zones beyond this are still formatted, just not shared
+#endif
+
+static void copyString(char* const* strs, uint8_t to, uint8_t from) {
+  if (strs) { strcpy(strs[to], strs[from]); }
+}
+
+void WorldClock::format(time_t utc, Timezone* const* zones, uint8_t count,
+                        char* const* longTimes, char* const* longDates,
+                        char* const* shortTimes, char* const* shortDates) {
+  formatZones(utc, zones, nullptr, count, longTimes, longDates, shortTimes, shortDates);
+}
+
+void WorldClock::format(time_t utc, LocalZone* const* zones, uint8_t count,
+                        char* const* longTimes, char* const* longDates,
+                        char* const* shortTimes, char* const* shortDates) {
+  formatZones(utc, nullptr, zones, count, longTimes, longDates, shortTimes, shortDates);
+}
+
+void WorldClock::formatZones(time_t utc, Timezone* const* zones, LocalZone* const* localZones, uint8_t count,
+                             char* const* longTimes, char* const* longDates,
+                             char* const* shortTimes, char* const* shortDates) {
+  const int32_t utcDays = utc / Time::secsPerDay;
+  const int32_t utcSecs = utc % Time::secsPerDay;
+
+  stime_t offsets[WORLDCLOCK_MAX_ZONES];
+
+  for (uint8_t i = 0; i < count; i++) {
+    stime_t off;
+    if (localZones && localZones[i]) {
+      off = localZones[i]->offset(utc);
+    } else {
+      Timezone* zone = zones && zones[i] ? zones[i] : LocalTime::getSystemTimezone();
+      off = zone->offset(utc);
+    }
+
+    uint8_t same = i;
+    for (uint8_t j = 0; j < i && j < WORLDCLOCK_MAX_ZONES; j++) {
+      if (offsets[j] == off) {
+        same = j;
+        break;
+      }
+    }
+    if (i < WORLDCLOCK_MAX_ZONES) {
+      offsets[i] = off;
+    }
+    if (same != i) {
+      copyString(longTimes, i, same);
+      copyString(longDates, i, same);
+      copyString(shortTimes, i, same);
+      copyString(shortDates, i, same);
+      continue;
+    }
+
+    int32_t days = utcDays;
+    int32_t secs = utcSecs + off;
+    if (secs < 0) {
+      secs += Time::secsPerDay;
+      days--;
+    } else if (secs >= (int32_t)Time::secsPerDay) {
+      secs -= Time::secsPerDay;
+      days++;
+    }
+
+    uint8_t hr = secs / Time::secsPerHour;
+    uint8_t min = secs % Time::secsPerHour / Time::secsPerMin;
+    uint8_t sec = secs % Time::secsPerMin;
+    uint8_t hr12 = hr % 12 ? hr % 12 : 12;
+    const char* ampm = hr < 12 ? "am" : "pm";
+
+    if (longTimes) { sprintf(longTimes[i], "%d:%02d:%02d %s", hr12, min, sec, ampm); }
+    if (shortTimes) { sprintf(shortTimes[i], "%d:%02d %s", hr12, min, ampm); }
+
+    if (longDates || shortDates) {
+      uint16_t y;
+      uint8_t m, d;
+      TimePoint::civilFromDays(days, y, m, d);
+      if (longDates) { sprintf(longDates[i], "%s, %s %d, %d", Time::weekdayName(TimePoint::weekdayFromDays(days)), Time::monthName(m), d, y); }
+      if (shortDates) { sprintf(shortDates[i], "%d-%02d-%02d", y, m, d); }
+    }
+  }
+}
@@ -0,0 +1,44 @@
+#ifndef _WorldClock_
+#define _WorldClock_
+
+#include "Clock.h"
+
+// WorldClock formats a single instant in many zones at once, for example for a world clock display.
+// The instant is split into days and seconds once, each zone's offset is applied to that, and zones
+// that currently share an offset share their strings instead of formatting them again.
+//
+// The strings are in the same formats as Time::longTime(), longDate(), shortTime() and shortDate().
+class WorldClock {
+  public:
+    // any of the string arrays may be nullptr, otherwise they need count strings, each with room for the format
+    // (30 chars is enough for all of them).  A nullptr zone uses the system timezone.
+    static void format(time_t utc, Timezone* const* zones, uint8_t count,
+                       char* const* longTimes, char* const* longDates = nullptr,
+                       char* const* shortTimes = nullptr, char* const* shortDates = nullptr);
+
+    // same, for the current time of the shared RTCClock
+    static void format(Timezone* const* zones, uint8_t count,
+                       char* const* longTimes, char* const* longDates = nullptr,
+                       char* const* shortTimes = nullptr, char* const* shortDates = nullptr) {
+      format(RTCClock::utcMicros() / Time::microsPerSec, zones, count, longTimes, longDates, shortTimes, shortDates);
+    }
+
+    // same, for zones such as TZifZone that aren't Timezone rule objects
+    static void format(time_t utc, LocalZone* const* zones, uint8_t count,
+                       char* const* longTimes, char* const* longDates = nullptr,
+                       char* const* shortTimes = nullptr, char* const* shortDates = nullptr);
+
+    static void format(LocalZone* const* zones, uint8_t count,
+                       char* const* longTimes, char* const* longDates = nullptr,
+                       char* const* shortTimes = nullptr, char* const* shortDates = nullptr) {
+      format(RTCClock::utcMicros() / Time::microsPerSec, zones, count, longTimes, longDates, shortTimes, shortDates);
+    }
+
+  private:
+    // exactly one of zones and localZones is given
+    static void formatZones(time_t utc, Timezone* const* zones, LocalZone* const* localZones, uint8_t count,
+                            char* const* longTimes, char* const* longDates,
+                            char* const* shortTimes, char* const* shortDates);
+};
+
+#endif